@@ -2,6 +2,7 @@ import esphome.codegen as cg
 from esphome.components import climate
 import esphome.config_validation as cv
 from esphome.const import CONF_ID
+from esphome.core import CORE, ID, coroutine_with_priority
 
 CODEOWNERS = ["@Sammy1Am", "@KazWolfe"]
 
@@ -10,7 +11,10 @@ itp_packet_ns = cg.esphome_ns.namespace("itp_packet")
 MitsubishiUART = mitsubishi_itp_ns.class_(
     "MitsubishiUART", cg.PollingComponent, climate.Climate
 )
+StaticListenerTable = mitsubishi_itp_ns.class_("StaticListenerTable")
 CONF_MITSUBISHI_ITP_ID = "mitsubishi_itp_id"
+CONF_STATIC_LISTENERS = "static_listeners"
+DOMAIN = "mitsubishi_itp"
 
 
 def sensors_to_config_schema(sensors):
@@ -37,4 +41,41 @@ async def sensors_to_code(config, sensors, registration_function):
 
             await registration_function(sensor_component, sensor_conf)
 
-            cg.add(getattr(mitp_component, "register_listener")(sensor_component))
\ No newline at end of file
+            register_listener(
+                mitp_component,
+                config[CONF_MITSUBISHI_ITP_ID],
+                sensor_component,
+                sensor_conf[CONF_ID],
+            )
+
+
+def uses_static_listeners(mitp_id):
+    for climate_entry in CORE.config.get("climate", []):
+        if isinstance(climate_entry, dict) and climate_entry.get(CONF_ID) == mitp_id:
+            return climate_entry.get(CONF_STATIC_LISTENERS, False)
+    return False
+
+
+def register_listener(mitp_component, mitp_id, listener_component, listener_id):
+    """Registers a listener with the hub, or if static listeners are enabled, adds it to the hub's listener table."""
+    if uses_static_listeners(mitp_id):
+        listeners = CORE.data.setdefault(DOMAIN, {}).setdefault(str(mitp_id), [])
+        listeners.append((listener_component, listener_id))
+    else:
+        cg.add(getattr(mitp_component, "register_listener")(listener_component))
+
+
+# Runs after all the platforms have added their listeners
+@coroutine_with_priority(-100.0)
+async def listener_table_to_code(mitp_id):
+    mitp_component = await cg.get_variable(mitp_id)
+    listeners = CORE.data.get(DOMAIN, {}).get(str(mitp_id), [])
+
+    table_type = StaticListenerTable.template(
+        *[listener_id.type for _, listener_id in listeners]
+    )
+    table_id = ID(f"{mitp_id.id}_listener_table", is_declaration=True, type=table_type)
+    table = cg.new_Pvariable(
+        table_id, *[listener_component for listener_component, _ in listeners]
+    )
+    cg.add(getattr(mitp_component, "set_listener_table")(table))
\ No newline at end of file
@@ -1,5 +1,6 @@
 from esphome.components import binary_sensor
 import esphome.config_validation as cv
+from esphome.const import DEVICE_CLASS_CONNECTIVITY, ENTITY_CATEGORY_DIAGNOSTIC
 from esphome.core import coroutine
 
 from ...mitsubishi_itp import (
@@ -11,6 +12,9 @@ from ...mitsubishi_itp import (
 CONF_ISEE_STATUS = "isee_status"
 
 
+ConnectedSensor = mitsubishi_itp_ns.class_(
+    "ConnectedSensor", binary_sensor.BinarySensor
+)
 DefrostSensor = mitsubishi_itp_ns.class_("DefrostSensor", binary_sensor.BinarySensor)
 FilterStatusSensor = mitsubishi_itp_ns.class_(
     "FilterStatusSensor", binary_sensor.BinarySensor
@@ -20,6 +24,9 @@ ISeeStatusSensor = mitsubishi_itp_ns.class_(
 )
 PreheatSensor = mitsubishi_itp_ns.class_("PreheatSensor", binary_sensor.BinarySensor)
 StandbySensor = mitsubishi_itp_ns.class_("StandbySensor", binary_sensor.BinarySensor)
+StaleStateSensor = mitsubishi_itp_ns.class_(
+    "StaleStateSensor", binary_sensor.BinarySensor
+)
 UsingInternalTemperatureSensor = mitsubishi_itp_ns.class_(
     "UsingInternalTemperatureSensor", binary_sensor.BinarySensor
 )
@@ -27,6 +34,11 @@ UsingInternalTemperatureSensor = mitsubishi_itp_ns.class_(
 # TODO Storing the registration function here seems weird, but I can't figure out how to determine schema type later
 SENSORS = dict[str, cv.Schema](
     {
+        "connected": binary_sensor.binary_sensor_schema(
+            ConnectedSensor,
+            device_class=DEVICE_CLASS_CONNECTIVITY,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
         "defrost": binary_sensor.binary_sensor_schema(
             DefrostSensor, icon="mdi:snowflake-melt"
         ),
@@ -42,6 +54,11 @@ SENSORS = dict[str, cv.Schema](
         "standby": binary_sensor.binary_sensor_schema(
             StandbySensor, icon="mdi:pause-circle-outline"
         ),
+        "stale_state": binary_sensor.binary_sensor_schema(
+            StaleStateSensor,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            icon="mdi:history",
+        ),
         "using_internal_temperature": binary_sensor.binary_sensor_schema(
             UsingInternalTemperatureSensor, icon="mdi:thermometer-check"
         ),
@@ -21,26 +21,68 @@ class MITPBinarySensor : public MITPListener, public binary_sensor::BinarySensor
 };
 
 class DefrostSensor : public MITPBinarySensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_DEFROST; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_RUN_STATE_GET_RESPONSE); }
   void process_packet(const RunStateGetResponsePacket &packet) { mitp_binary_sensor_state_ = packet.in_defrost(); }
 };
 class FilterStatusSensor : public MITPBinarySensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_FILTER; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_RUN_STATE_GET_RESPONSE); }
   void process_packet(const RunStateGetResponsePacket &packet) { mitp_binary_sensor_state_ = packet.service_filter(); }
 };
 class PreheatSensor : public MITPBinarySensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_PREHEAT; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_RUN_STATE_GET_RESPONSE); }
   void process_packet(const RunStateGetResponsePacket &packet) { mitp_binary_sensor_state_ = packet.in_preheat(); }
 };
 class StandbySensor : public MITPBinarySensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_STANDBY; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_RUN_STATE_GET_RESPONSE); }
   void process_packet(const RunStateGetResponsePacket &packet) { mitp_binary_sensor_state_ = packet.in_standby(); }
 };
 class ISeeStatusSensor : public MITPBinarySensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_ISEE; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_SETTINGS_GET_RESPONSE); }
   void process_packet(const SettingsGetResponsePacket &packet) {
     mitp_binary_sensor_state_ = packet.is_i_see_enabled();
   }
 };
 
 class UsingInternalTemperatureSensor : public MITPBinarySensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_USING_INTERNAL_TEMPERATURE; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_USING_INTERNAL_TEMPERATURE); }
   void using_internal_temperature(const bool using_internal) { mitp_binary_sensor_state_ = using_internal; }
 };
 
+// On until the heat pump has reported its settings since boot or since its link was lost (the climate shows the last
+// known state until then)
+class StaleStateSensor : public MITPBinarySensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_STALE; }
+  uint32_t get_subscriptions() const override {
+    return listener_event_bit(LISTENER_EVENT_SETTINGS_GET_RESPONSE) | listener_event_bit(LISTENER_EVENT_LINK_STATE);
+  }
+  void setup() override { mitp_binary_sensor_state_ = true; }
+  void process_packet(const SettingsGetResponsePacket &packet) { mitp_binary_sensor_state_ = false; }
+  void link_state(const bool connected, const uint32_t reconnects) override {
+    if (!connected) {
+      mitp_binary_sensor_state_ = true;
+    }
+  }
+};
+
+class ConnectedSensor : public MITPBinarySensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_CONNECTED; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_LINK_STATE); }
+  void link_state(const bool connected, const uint32_t reconnects) override { mitp_binary_sensor_state_ = connected; }
+};
+
 }  // namespace mitsubishi_itp
 }  // namespace esphome
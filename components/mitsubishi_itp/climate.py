@@ -7,10 +7,17 @@ from esphome.const import (
     CONF_SUPPORTED_FAN_MODES,
     CONF_SUPPORTED_MODES,
     CONF_TIME_ID,
+    CONF_UPDATE_INTERVAL,
 )
-from esphome.core import coroutine
+from esphome.core import CORE, coroutine
 
-from . import MitsubishiUART, itp_packet_ns
+from . import (
+    CONF_STATIC_LISTENERS,
+    MitsubishiUART,
+    itp_packet_ns,
+    listener_table_to_code,
+    mitsubishi_itp_ns,
+)
 
 DEPENDENCIES = [
     "uart",
@@ -23,6 +30,25 @@ CONF_ENHANCED_MHK_SUPPORT = (
     "enhanced_mhk"  # EXPERIMENTAL. Will be set to default eventually.
 )
 CONF_RECALL_SETPOINT = "recall_setpoint"
+CONF_QUEUE_OVERFLOW_POLICY = "queue_overflow_policy"
+CONF_SETTINGS_DEBOUNCE = "settings_debounce"
+CONF_PASSTHROUGH_CUT_THROUGH = "passthrough_cut_through"
+CONF_IN_FLIGHT_WINDOW = "in_flight_window"
+CONF_POLLING = "polling"
+CONF_POLL_SETTINGS = "settings"
+CONF_POLL_RUN_STATE = "run_state"
+CONF_POLL_STATUS = "status"
+CONF_POLL_CURRENT_TEMPERATURE = "current_temperature"
+CONF_POLL_ERROR_INFO = "error_info"
+CONF_POLL_OFF_INTERVAL = "off_interval"
+CONF_POLL_BOOST_INTERVAL = "boost_interval"
+CONF_POLL_BOOST_DURATION = "boost_duration"
+CONF_THERMOSTAT_PROXY = "thermostat_proxy"
+CONF_LINK_WATCHDOG = "link_watchdog"
+CONF_MAX_TIMEOUTS = "max_timeouts"
+CONF_SILENCE_TIMEOUT = "silence_timeout"
+CONF_RECONNECT_INTERVAL = "reconnect_interval"
+CONF_MAX_RECONNECT_INTERVAL = "max_reconnect_interval"
 
 DEFAULT_POLLING_INTERVAL = "5s"
 
@@ -32,7 +58,116 @@ CUSTOM_FAN_MODES = {"VERYHIGH": itp_packet_ns.FAN_MODE_VERYHIGH}
 
 validate_custom_fan_modes = cv.enum(CUSTOM_FAN_MODES, upper=True)
 
-CONFIG_SCHEMA = (
+QueueOverflowPolicy = mitsubishi_itp_ns.enum("QueueOverflowPolicy", is_class=True)
+QUEUE_OVERFLOW_POLICIES = {
+    "DROP_NEW": QueueOverflowPolicy.DROP_NEW,
+    "EVICT_LOWEST": QueueOverflowPolicy.EVICT_LOWEST,
+}
+
+GetCommand = itp_packet_ns.enum("GetCommand", is_class=True)
+POLLED_COMMANDS = {
+    CONF_POLL_SETTINGS: GetCommand.SETTINGS,
+    CONF_POLL_RUN_STATE: GetCommand.RUN_STATE,
+    CONF_POLL_STATUS: GetCommand.STATUS,
+    CONF_POLL_CURRENT_TEMPERATURE: GetCommand.CURRENT_TEMP,
+    CONF_POLL_ERROR_INFO: GetCommand.ERROR_INFO,
+}
+
+# Intervals that aren't set are multiples of update_interval (5s, 5s, 5s, 10s and 60s by default)
+POLL_INTERVAL_MULTIPLIERS = {
+    CONF_POLL_SETTINGS: 1,
+    CONF_POLL_RUN_STATE: 1,
+    CONF_POLL_STATUS: 1,
+    CONF_POLL_CURRENT_TEMPERATURE: 2,
+    CONF_POLL_ERROR_INFO: 12,
+}
+
+POLLING_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_POLL_SETTINGS): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_RUN_STATE): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_STATUS): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_CURRENT_TEMPERATURE): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_ERROR_INFO): cv.positive_time_period_milliseconds,
+        # Slower interval used while the unit is off (settings are still polled as normal), 0s to disable
+        cv.Optional(
+            CONF_POLL_OFF_INTERVAL, default="60s"
+        ): cv.positive_time_period_milliseconds,
+        # Faster interval for settings, status and run state after a change is seen, 0s to disable
+        cv.Optional(
+            CONF_POLL_BOOST_INTERVAL, default="1s"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(
+            CONF_POLL_BOOST_DURATION, default="15s"
+        ): cv.positive_time_period_milliseconds,
+    }
+)
+
+# How old a cached response can be and still be used to answer the thermostat, 0s to always forward that request.
+# Defaults are twice the poll intervals, so entries are normally refreshed by polling before they expire.
+THERMOSTAT_PROXY_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_POLL_SETTINGS): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_RUN_STATE): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_STATUS): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_CURRENT_TEMPERATURE): cv.positive_time_period_milliseconds,
+    }
+)
+
+
+def default_poll_intervals(config):
+    """Fills in the poll intervals (and thermostat proxy TTLs) that weren't set, based on update_interval."""
+    update_interval = config[CONF_UPDATE_INTERVAL]
+    if not isinstance(update_interval, cv.TimePeriod):
+        # update_interval: never still needs the heat pump to be polled
+        update_interval = cv.positive_time_period_milliseconds(DEFAULT_POLLING_INTERVAL)
+
+    polling_conf = config[CONF_POLLING]
+    for conf_key, multiplier in POLL_INTERVAL_MULTIPLIERS.items():
+        if conf_key not in polling_conf:
+            polling_conf[conf_key] = cv.TimePeriodMilliseconds(
+                milliseconds=update_interval.total_milliseconds * multiplier
+            )
+
+    if (proxy_conf := config.get(CONF_THERMOSTAT_PROXY)) is not None:
+        for conf_key in THERMOSTAT_PROXY_SCHEMA.schema:
+            if str(conf_key) not in proxy_conf:
+                proxy_conf[str(conf_key)] = cv.TimePeriodMilliseconds(
+                    milliseconds=polling_conf[str(conf_key)].total_milliseconds * 2
+                )
+    return config
+
+
+LINK_WATCHDOG_SCHEMA = cv.Schema(
+    {
+        # The link is considered lost after this many requests in a row go unanswered (after retries)
+        cv.Optional(CONF_MAX_TIMEOUTS, default=3): cv.int_range(min=1, max=255),
+        # ...or nothing's been received for this long, 0s to disable.  Must be longer than the settings poll interval,
+        # defaults to 30s or three settings polls, whichever is longer.
+        cv.Optional(CONF_SILENCE_TIMEOUT): cv.positive_time_period_milliseconds,
+        # Connect requests are then resent at this interval, doubling up to the maximum
+        cv.Optional(CONF_RECONNECT_INTERVAL, default="1s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=100)),
+        ),
+        cv.Optional(
+            CONF_MAX_RECONNECT_INTERVAL, default="30s"
+        ): cv.positive_time_period_milliseconds,
+    }
+)
+
+
+def default_silence_timeout(config):
+    link_conf = config[CONF_LINK_WATCHDOG]
+    if CONF_SILENCE_TIMEOUT not in link_conf:
+        settings_interval = config[CONF_POLLING][CONF_POLL_SETTINGS]
+        link_conf[CONF_SILENCE_TIMEOUT] = cv.TimePeriodMilliseconds(
+            milliseconds=max(30000, settings_interval.total_milliseconds * 3)
+        )
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
     climate.climate_schema(MitsubishiUART)
     .extend(
         {
@@ -51,13 +186,40 @@ CONFIG_SCHEMA = (
             ),
             cv.Optional(CONF_ENHANCED_MHK_SUPPORT, default=False): cv.boolean,
             cv.Optional(CONF_RECALL_SETPOINT, default=False): cv.boolean,
+            cv.Optional(CONF_QUEUE_OVERFLOW_POLICY, default="EVICT_LOWEST"): cv.enum(
+                QUEUE_OVERFLOW_POLICIES, upper=True
+            ),
+            cv.Optional(
+                CONF_SETTINGS_DEBOUNCE, default="100ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_PASSTHROUGH_CUT_THROUGH, default=False): cv.boolean,
+            # Answers the thermostat's polls from the heat pump's last responses (requires uart_thermostat)
+            cv.Optional(CONF_THERMOSTAT_PROXY): THERMOSTAT_PROXY_SCHEMA,
+            # EXPERIMENTAL. Not all units handle more than one request at a time.
+            cv.Optional(CONF_IN_FLIGHT_WINDOW, default=1): cv.int_range(min=1, max=4),
+            cv.Optional(CONF_POLLING, default={}): POLLING_SCHEMA,
+            cv.Optional(CONF_LINK_WATCHDOG, default={}): LINK_WATCHDOG_SCHEMA,
+            # Wires up sensors/selects at compile time rather than registering them at runtime
+            cv.Optional(CONF_STATIC_LISTENERS, default=False): cv.boolean,
         }
     )
-    .extend(cv.polling_component_schema(DEFAULT_POLLING_INTERVAL))
+    .extend(cv.polling_component_schema(DEFAULT_POLLING_INTERVAL)),
+    default_poll_intervals,
+    default_silence_timeout,
 )
 
 
 def final_validate(config):
+    # Settings are always polled, so a shorter silence timeout would drop the link in a loop
+    silence_timeout = config[CONF_LINK_WATCHDOG][CONF_SILENCE_TIMEOUT]
+    settings_interval = config[CONF_POLLING][CONF_POLL_SETTINGS]
+    if 0 < silence_timeout.total_milliseconds <= settings_interval.total_milliseconds:
+        raise cv.Invalid(
+            f"{CONF_SILENCE_TIMEOUT} ({silence_timeout}) must be longer than the "
+            f"{CONF_POLL_SETTINGS} poll interval ({settings_interval}), or 0s to disable.",
+            path=[CONF_LINK_WATCHDOG, CONF_SILENCE_TIMEOUT],
+        )
+
     schema = uart.final_validate_device_schema(
         "mitsubishi_itp",
         uart_bus=CONF_UART_HEATPUMP,
@@ -127,6 +289,71 @@ async def to_code(config):
         )
     if rs_conf := config.get(CONF_RECALL_SETPOINT):
         cg.add(getattr(mitp_component, "set_recall_setpoint")(rs_conf))
+    if ct_conf := config.get(CONF_PASSTHROUGH_CUT_THROUGH):
+        cg.add(getattr(mitp_component, "set_passthrough_cut_through")(ct_conf))
+
+    if proxy_conf := config.get(CONF_THERMOSTAT_PROXY):
+        if CONF_UART_THERMOSTAT not in config:
+            raise cv.RequiredFieldInvalid(
+                f"'{CONF_UART_THERMOSTAT}' is required if {CONF_THERMOSTAT_PROXY} is set."
+            )
+        for conf_key, ttl in proxy_conf.items():
+            cg.add(
+                getattr(mitp_component, "set_thermostat_proxy_ttl")(
+                    POLLED_COMMANDS[conf_key], ttl.total_milliseconds
+                )
+            )
+
+    if config[CONF_STATIC_LISTENERS]:
+        CORE.add_job(listener_table_to_code, config[CONF_ID])
+
+    cg.add(
+        getattr(mitp_component, "set_queue_overflow_policy")(
+            config[CONF_QUEUE_OVERFLOW_POLICY]
+        )
+    )
+    cg.add(
+        getattr(mitp_component, "set_in_flight_window")(config[CONF_IN_FLIGHT_WINDOW])
+    )
+    polling_conf = config[CONF_POLLING]
+    for conf_key, command in POLLED_COMMANDS.items():
+        cg.add(
+            getattr(mitp_component, "set_poll_interval")(
+                command, polling_conf[conf_key].total_milliseconds
+            )
+        )
+    cg.add(
+        getattr(mitp_component, "set_poll_off_interval")(
+            polling_conf[CONF_POLL_OFF_INTERVAL].total_milliseconds
+        )
+    )
+    cg.add(
+        getattr(mitp_component, "set_poll_boost")(
+            polling_conf[CONF_POLL_BOOST_INTERVAL].total_milliseconds,
+            polling_conf[CONF_POLL_BOOST_DURATION].total_milliseconds,
+        )
+    )
+    link_conf = config[CONF_LINK_WATCHDOG]
+    cg.add(
+        getattr(mitp_component, "set_link_timeout")(
+            link_conf[CONF_MAX_TIMEOUTS],
+            link_conf[CONF_SILENCE_TIMEOUT].total_milliseconds,
+        )
+    )
+    cg.add(
+        getattr(mitp_component, "set_reconnect_interval")(
+            link_conf[CONF_RECONNECT_INTERVAL].total_milliseconds,
+            max(
+                link_conf[CONF_RECONNECT_INTERVAL].total_milliseconds,
+                link_conf[CONF_MAX_RECONNECT_INTERVAL].total_milliseconds,
+            ),
+        )
+    )
+    cg.add(
+        getattr(mitp_component, "set_settings_debounce_ms")(
+            config[CONF_SETTINGS_DEBOUNCE].total_milliseconds
+        )
+    )
 
     try:
         cg.add_library(
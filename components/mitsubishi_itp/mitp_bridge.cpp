@@ -6,212 +6,682 @@ namespace mitsubishi_itp {
 MITPBridge::MITPBridge(uart::UARTComponent *uart_component, PacketProcessor *packet_processor)
     : uart_comp_{*uart_component}, pkt_processor_{*packet_processor} {}
 
-// The heatpump loop expects responses for most sent packets, so it tracks the last send packet and wait for a response
+/* The heatpump loop expects responses for most sent packets, so it tracks the requests that are in flight (sent and
+waiting for a response).  Every complete packet already received is processed in a single pass, and if that frees up
+the bridge (or a pending request timed out) the next queued packets are sent in the same pass rather than waiting for
+another loop().
+
+Received packets are matched to the request they answer by packet type and command, packets that don't match any
+request in flight are processed as unsolicited and don't affect the requests that are waiting.  Normally only one
+request is in flight at a time, but the window can be raised for units that handle pipelined requests.
+
+How long to wait for a response is derived from the measured response time of previous requests of the same kind, so
+a lost packet doesn't hold up the bus for long on a fast unit.  Requests that are safe to repeat are retried (with
+backoff) a few times after a timeout.
+
+Requests sent with a callback are completed once they're answered (after the response has been processed as usual), or
+once they've timed out for good.  Packets are taken out of the queue before they're sent, so a callback that queues
+more packets doesn't disturb the loop.
+*/
 void HeatpumpBridge::loop() {
-  // Try to get a packet
-  if (optional<RawPacket> pkt = receive_raw_packet_(
-          SourceBridge::HEATPUMP, packet_awaiting_response_ ? packet_awaiting_response_->get_controller_association()
-                                                            : ControllerAssociation::MITP)) {
+  size_t rx_budget = RX_BYTE_BUDGET;
+
+  // Process all the packets we can get
+  while (optional<RawPacket> pkt =
+             receive_raw_packet_(SourceBridge::HEATPUMP, ControllerAssociation::MITP, rx_budget)) {
     ESP_LOGV(BRIDGE_TAG, "Parsing %x heatpump packet", pkt.value().get_packet_type());
-    // Check the packet's checksum and either process it, or log an error
-    if (pkt.value().is_checksum_valid()) {
-      // If we're waiting for a response, associate the incomming packet with the request packet
-      classify_and_process_raw_packet_(pkt.value());
+    // Anything that passed its checksum shows the heat pump is still there
+    last_rx_millis_ = millis();
+    consecutive_timeouts_ = 0;
+
+    const int request_index = find_in_flight_(pkt.value());
+    if (request_index < 0) {
+      ESP_LOGD(BRIDGE_TAG, "Received unsolicited %x packet.", pkt.value().get_packet_type());
+      dispatch_received_packet_(pkt.value());
+      continue;
+    }
+
+    InFlightRequest request = std::move(in_flight_[request_index]);
+    remove_in_flight_(request_index);
+
+    // Only sample requests that weren't retried, since we can't tell which attempt a response belongs to
+    if (request.packet.get_retries() == 0) {
+      ResponseTimeEstimate *estimate =
+          find_estimate_(request.packet.get_packet_type(), request.packet.get_command(), true);
+      if (estimate != nullptr) {
+        estimate->add_sample(millis() - request.sent_millis);
+      }
+    }
+
+    // Processing consumes the packet, so the callback gets its own copy
+    optional<RawPacket> callback_response;
+    if (request.packet.has_callback()) {
+      callback_response = RawPacket(pkt.value().get_bytes(), pkt.value().get_length(), SourceBridge::HEATPUMP,
+                                    request.packet.get_controller_association());
+    }
+
+    // Associate the response with the controller that sent the request
+    if (request.packet.get_controller_association() != ControllerAssociation::MITP) {
+      RawPacket response = RawPacket(pkt.value().get_bytes(), pkt.value().get_length(), SourceBridge::HEATPUMP,
+                                     request.packet.get_controller_association());
+      dispatch_received_packet_(response, &request.packet);
+    } else {
+      dispatch_received_packet_(pkt.value(), &request.packet);
+    }
+
+    if (callback_response.has_value()) {
+      request.packet.complete(RequestStatus::RESPONDED, &callback_response.value());
+    }
+  }
+
+  // Retry or give up on requests we've been waiting on too long
+  const uint32_t now = millis();
+  for (size_t i = 0; i < in_flight_count_;) {
+    if (now - in_flight_[i].sent_millis > in_flight_[i].timeout_ms) {
+      InFlightRequest request = std::move(in_flight_[i]);
+      remove_in_flight_(i);
+      retry_request_(std::move(request.packet));
     } else {
-      ESP_LOGW(BRIDGE_TAG, "Invalid packet checksum!\n%s",
-               format_hex_pretty(&pkt.value().get_bytes()[0], pkt.value().get_length()).c_str());
+      i++;
     }
+  }
 
-    // If there was a packet waiting for a response, remove it.
-    // TODO: This incoming packet wasn't *nessesarily* a response, but for now
-    // it's probably not worth checking to make sure it matches.
-    if (packet_awaiting_response_) {
-      packet_awaiting_response_.reset();
+  // Send the first packets in the queue that aren't waiting to be retried, while there's room in the window
+  for (size_t i = 0; i < queue_size_ && in_flight_count_ < in_flight_window_;) {
+    if (!queue_at_(i).is_ready(now)) {
+      i++;
+      continue;
     }
-  } else if (!packet_awaiting_response_ && !pkt_queue_.empty()) {
-    // If we're not waiting for a response and there's a packet in the queue...
 
-    ESP_LOGV(BRIDGE_TAG, "Sending to heatpump %s", pkt_queue_.front()->to_string().c_str());
-    write_raw_packet_(pkt_queue_.front()->raw_packet());
-    packet_sent_millis_ = millis();
+    ESP_LOGV(BRIDGE_TAG, "Sending to heatpump %s",
+             format_hex_pretty(queue_at_(i).get_bytes(), queue_at_(i).get_length()).c_str());
+    QueuedPacket packet = std::move(queue_at_(i));
 
-    // If the packet expects a response, *move* it to the awaitingResponse variable
-    if (pkt_queue_.front()->is_response_expected()) {
-      packet_awaiting_response_ = std::move(pkt_queue_.front());
+    // Free the queue slot
+    if (i == 0) {
+      queue_pop_();
+    } else {
+      queue_remove_(i);
     }
 
-    // Remove (now empty!) packet pointer from queue
-    pkt_queue_.pop();
-  } else if (packet_awaiting_response_ && (millis() - packet_sent_millis_ > RESPONSE_TIMEOUT_MS)) {
-    // We've been waiting too long for a response, give up
-    // TODO: We could potentially retry here, but that seems unnecessary
-    ESP_LOGW(BRIDGE_TAG, "Timeout waiting for response to %x packet.", packet_awaiting_response_->get_packet_type());
-    packet_awaiting_response_.reset();
+    send_request_(std::move(packet));
   }
 }
 
+void HeatpumpBridge::set_in_flight_window(const uint8_t window) {
+  in_flight_window_ = std::clamp(window, static_cast<uint8_t>(1), static_cast<uint8_t>(MAX_IN_FLIGHT));
+}
+
+void HeatpumpBridge::reset() {
+  // Everything is cleared before any callbacks are called, in case they queue anything
+  std::array<DeferredCompletion, MAX_QUEUE_SIZE + MAX_IN_FLIGHT> dropped;
+  size_t dropped_count = 0;
+  for (size_t i = 0; i < queue_size_; i++) {
+    dropped[dropped_count++].callback = queue_at_(i).take_callback();
+  }
+  for (size_t i = 0; i < in_flight_count_; i++) {
+    dropped[dropped_count++].callback = in_flight_[i].packet.take_callback();
+  }
+
+  queue_head_ = 0;
+  queue_size_ = 0;
+  in_flight_count_ = 0;
+  rx_length_ = 0;
+  consecutive_timeouts_ = 0;
+  last_rx_millis_ = millis();
+
+  for (size_t i = 0; i < dropped_count; i++) {
+    dropped[i].run();
+  }
+}
+
+// Writes a packet to the heat pump, and if it expects a response, adds it to the requests in flight
+void HeatpumpBridge::send_request_(QueuedPacket &&packet) {
+  write_raw_packet_(packet);
+
+  if (!packet.is_response_expected()) {
+    packet.complete(RequestStatus::SENT);
+    return;
+  }
+
+  InFlightRequest &request = in_flight_[in_flight_count_++];
+  request.packet = std::move(packet);
+  request.sent_millis = millis();
+
+  // Back off the timeout for retries, in case the response is just slower than expected
+  const ResponseTimeEstimate *estimate =
+      find_estimate_(request.packet.get_packet_type(), request.packet.get_command(), false);
+  const uint32_t timeout = estimate != nullptr ? estimate->timeout_ms() : RESPONSE_TIMEOUT_MS;
+  request.timeout_ms = std::min(timeout << request.packet.get_retries(), RESPONSE_TIMEOUT_MS);
+}
+
+/* Finds the oldest request in flight that a received packet answers, or -1 if it doesn't answer any.  A response has
+its request's packet type with RESPONSE_TYPE_FLAG set.  GET responses carry the command that was requested, so must
+match it too, other responses (e.g. to SET requests) don't and are matched to the oldest request of their type.*/
+int HeatpumpBridge::find_in_flight_(const RawPacket &pkt) const {
+  const uint8_t packet_type = pkt.get_packet_type();
+  if ((packet_type & RESPONSE_TYPE_FLAG) == 0) {
+    return -1;  // Not a response
+  }
+
+  for (size_t i = 0; i < in_flight_count_; i++) {
+    const QueuedPacket &request = in_flight_[i].packet;
+    if ((request.get_packet_type() | RESPONSE_TYPE_FLAG) != packet_type) {
+      continue;
+    }
+    if (static_cast<PacketType>(packet_type) == PacketType::GET_RESPONSE &&
+        request.get_command() != pkt.get_command()) {
+      continue;
+    }
+    return static_cast<int>(i);
+  }
+  return -1;
+}
+
+void HeatpumpBridge::remove_in_flight_(const size_t index) {
+  for (size_t i = index; i + 1 < in_flight_count_; i++) {
+    in_flight_[i] = std::move(in_flight_[i + 1]);
+  }
+  in_flight_count_--;
+}
+
+/* Requeues a timed out request if it's safe to send again and hasn't run out of retries.  If an equivalent packet was
+queued in the meantime, it's newer than this one, so that one is left to be sent instead (and completes this request's
+callback too).*/
+void HeatpumpBridge::retry_request_(QueuedPacket &&request) {
+  QueuedPacket retry = std::move(request);
+  if (!is_retryable_(retry) || retry.get_retries() >= MAX_RETRIES) {
+    ESP_LOGW(BRIDGE_TAG, "Timeout waiting for response to %x packet.", retry.get_packet_type());
+    if (consecutive_timeouts_ < UINT8_MAX) {
+      consecutive_timeouts_++;
+    }
+    retry.complete(RequestStatus::TIMED_OUT);
+    return;
+  }
+
+  const uint8_t retries = retry.get_retries() + 1;
+  ESP_LOGD(BRIDGE_TAG, "Timeout waiting for response to %x packet, retrying (%d/%d).", retry.get_packet_type(),
+           retries, MAX_RETRIES);
+
+  QueuedPacket *slot = nullptr;
+  RequestCallback callback = retry.take_callback();
+  DeferredCompletion displaced;
+  bool coalesced = false;
+  if (!enqueue_slot_(retry.get_packet_type(), retry.get_command(), retry.get_controller_association(),
+                     retry.get_priority(), &slot, callback, displaced, &coalesced)) {
+    displaced.callback = std::move(callback);
+    displaced.status = RequestStatus::DROPPED;
+    displaced.run();
+    return;
+  }
+
+  if (coalesced) {
+    // The queued packet is kept as it is.  If it was handed over to be replaced, it keeps its callback too.
+    if (slot != nullptr) {
+      slot->set_callback(chain_callbacks_(std::move(displaced.callback), std::move(callback)));
+      displaced.callback = nullptr;
+    }
+    ESP_LOGV(BRIDGE_TAG, "Newer %x packet already queued, not retrying.", retry.get_packet_type());
+    return;
+  }
+
+  retry.set_retry(retries, millis() + (RETRY_BACKOFF_MS << (retries - 1)));
+  *slot = std::move(retry);
+  slot->set_callback(std::move(callback));
+  displaced.run();
+}
+
+// Only our own reads and remote temperature updates are retried, sending them twice does no harm
+bool HeatpumpBridge::is_retryable_(const QueuedPacket &packet) {
+  if (packet.get_controller_association() != ControllerAssociation::MITP) {
+    return false;  // The thermostat will retry its own requests
+  }
+
+  switch (static_cast<PacketType>(packet.get_packet_type())) {
+    case PacketType::CONNECT_REQUEST:
+    case PacketType::IDENTIFY_REQUEST:
+    case PacketType::GET_REQUEST:
+      return true;
+    case PacketType::SET_REQUEST:
+      return static_cast<SetCommand>(packet.get_command()) == SetCommand::REMOTE_TEMPERATURE;
+    default:
+      return false;
+  }
+}
+
+// Finds the response time estimate for a kind of request, adding one if create is set and there's room
+ResponseTimeEstimate *HeatpumpBridge::find_estimate_(const uint8_t packet_type, const uint8_t command,
+                                                     const bool create) {
+  for (size_t i = 0; i < response_time_estimate_count_; i++) {
+    if (response_time_estimates_[i].packet_type == packet_type && response_time_estimates_[i].command == command) {
+      return &response_time_estimates_[i];
+    }
+  }
+
+  if (!create || response_time_estimate_count_ >= RESPONSE_TIME_TABLE_SIZE) {
+    return nullptr;
+  }
+
+  ResponseTimeEstimate &estimate = response_time_estimates_[response_time_estimate_count_++];
+  estimate.packet_type = packet_type;
+  estimate.command = command;
+  return &estimate;
+}
+
+void ResponseTimeEstimate::add_sample(const uint32_t sample_ms) {
+  if (smoothed_ms == 0) {
+    smoothed_ms = std::max(sample_ms, static_cast<uint32_t>(1));
+    variation_ms = sample_ms / 2;
+    return;
+  }
+
+  const uint32_t error_ms = sample_ms > smoothed_ms ? sample_ms - smoothed_ms : smoothed_ms - sample_ms;
+  variation_ms = (3 * variation_ms + error_ms) / 4;
+  smoothed_ms = std::max((7 * smoothed_ms + sample_ms) / 8, static_cast<uint32_t>(1));
+}
+
+uint32_t ResponseTimeEstimate::timeout_ms() const {
+  if (smoothed_ms == 0) {
+    return RESPONSE_TIMEOUT_MS;  // No samples yet
+  }
+  return std::clamp(smoothed_ms + 4 * variation_ms, MIN_RESPONSE_TIMEOUT_MS, RESPONSE_TIMEOUT_MS);
+}
+
 // The thermostat bridge loop doesn't expect any responses, so packets in queue are just sent without checking if they
 // expect a response
 void ThermostatBridge::loop() {
-  // Try to get a packet
-  if (optional<RawPacket> pkt = receive_raw_packet_(SourceBridge::THERMOSTAT, ControllerAssociation::THERMOSTAT)) {
+  size_t rx_budget = RX_BYTE_BUDGET;
+
+  // Process all the packets we can get
+  while (optional<RawPacket> pkt =
+             receive_raw_packet_(SourceBridge::THERMOSTAT, ControllerAssociation::THERMOSTAT, rx_budget)) {
     ESP_LOGV(BRIDGE_TAG, "Parsing %x thermostat packet", pkt.value().get_packet_type());
-    // Check the packet's checksum and either process it, or log an error
-    if (pkt.value().is_checksum_valid()) {
-      classify_and_process_raw_packet_(pkt.value());
-    } else {
-      ESP_LOGW(BRIDGE_TAG, "Invalid packet checksum!\n%s",
-               format_hex_pretty(&pkt.value().get_bytes()[0], pkt.value().get_length()).c_str());
-    }
-  } else if (!pkt_queue_.empty()) {
-    // If there's a packet in the queue...
+    dispatch_received_packet_(pkt.value());
+  }
 
-    ESP_LOGV(BRIDGE_TAG, "Sending to thermostat %s", pkt_queue_.front()->to_string().c_str());
-    write_raw_packet_(pkt_queue_.front()->raw_packet());
-    packet_sent_millis_ = millis();
+  // Send everything in the queue
+  while (!queue_empty_()) {
+    ESP_LOGV(BRIDGE_TAG, "Sending to thermostat %s",
+             format_hex_pretty(queue_front_().get_bytes(), queue_front_().get_length()).c_str());
+    QueuedPacket packet = std::move(queue_at_(0));
 
     // Remove packet from queue
-    pkt_queue_.pop();
+    queue_pop_();
+
+    write_raw_packet_(packet);
+    packet.complete(RequestStatus::SENT);
+  }
+}
+
+CoalesceMode MITPBridge::coalesce_mode_(const uint8_t packet_type, const uint8_t command) {
+  switch (static_cast<PacketType>(packet_type)) {
+    case PacketType::CONNECT_REQUEST:
+    case PacketType::IDENTIFY_REQUEST:
+    case PacketType::GET_REQUEST:
+      return CoalesceMode::KEEP_QUEUED;
+    case PacketType::SET_REQUEST:
+      if (static_cast<SetCommand>(command) == SetCommand::REMOTE_TEMPERATURE) {
+        return CoalesceMode::REPLACE_QUEUED;
+      }
+      return CoalesceMode::NONE;
+    default:
+      return CoalesceMode::NONE;
+  }
+}
+
+/* Finds the queue slot a packet should be written to.  Normally this is a free slot positioned behind every queued
+packet of equal or higher priority.  If an equivalent packet is already queued with at least the same priority, *slot is
+either that packet's slot (to be overwritten) or nullptr if nothing needs to be written at all.  Returns false if the
+queue is full and the overflow policy doesn't allow making room.
+
+If the new packet will be sent in place of a queued one (coalesced), callback is moved onto it, or the queued packet's
+callback is moved onto callback, so both are completed by whichever is sent.  A queued packet that's superseded or
+evicted has its callback moved to displaced, for the caller to run once it's done with the slot.  If coalesced is given,
+it's set when the new packet was combined with a queued packet that was kept in its place (*slot is that packet's slot,
+or nullptr), rather than given a newly inserted slot.*/
+bool MITPBridge::enqueue_slot_(const uint8_t packet_type, const uint8_t command,
+                               const ControllerAssociation controller_association, const PacketPriority priority,
+                               QueuedPacket **slot, RequestCallback &callback, DeferredCompletion &displaced,
+                               bool *coalesced) {
+  const CoalesceMode coalesce_mode = coalesce_mode_(packet_type, command);
+  if (coalesce_mode != CoalesceMode::NONE) {
+    for (size_t i = 0; i < queue_size_; i++) {
+      QueuedPacket &queued = queue_at_(i);
+      if (!queued.is_equivalent(packet_type, command, controller_association)) {
+        continue;
+      }
+
+      if (queued.get_priority() >= priority) {
+        ESP_LOGV(BRIDGE_TAG, "Coalescing %x packet with queued packet.", packet_type);
+        if (coalesce_mode == CoalesceMode::REPLACE_QUEUED) {
+          displaced.callback = queued.take_callback();
+          displaced.status = RequestStatus::SUPERSEDED;
+          *slot = &queued;
+        } else {
+          queued.set_callback(chain_callbacks_(queued.take_callback(), std::move(callback)));
+          *slot = nullptr;
+        }
+        if (coalesced != nullptr) {
+          *coalesced = true;
+        }
+        return true;
+      }
+
+      // The new packet is more urgent, so drop the queued one and queue this one in its place
+      if (coalesce_mode == CoalesceMode::REPLACE_QUEUED) {
+        displaced.callback = queued.take_callback();
+        displaced.status = RequestStatus::SUPERSEDED;
+      } else {
+        callback = chain_callbacks_(queued.take_callback(), std::move(callback));
+      }
+      queue_remove_(i);
+      break;
+    }
+  }
+
+  if (queue_size_ >= MAX_QUEUE_SIZE) {
+    // The lowest priority packets are at the back of the queue, find the oldest of them
+    size_t victim = queue_size_ - 1;
+    while (victim > 0 && queue_at_(victim - 1).get_priority() == queue_at_(victim).get_priority()) {
+      victim--;
+    }
+
+    if (overflow_policy_ == QueueOverflowPolicy::DROP_NEW || queue_at_(victim).get_priority() >= priority) {
+      ESP_LOGW(BRIDGE_TAG, "Packet queue full!  %x packet not sent.", packet_type);
+      return false;
+    }
+
+    ESP_LOGW(BRIDGE_TAG, "Packet queue full!  Dropping queued %x packet to make room for %x packet.",
+             queue_at_(victim).get_packet_type(), packet_type);
+    displaced.callback = queue_at_(victim).take_callback();
+    displaced.status = RequestStatus::DROPPED;
+    queue_remove_(victim);
+  }
+
+  size_t position = queue_size_;
+  while (position > 0 && queue_at_(position - 1).get_priority() < priority) {
+    position--;
   }
+  for (size_t i = queue_size_; i > position; i--) {
+    queue_at_(i) = std::move(queue_at_(i - 1));
+  }
+  queue_size_++;
+
+  *slot = &queue_at_(position);
+  (*slot)->set_priority(priority);
+  return true;
+}
+
+// Combines two callbacks, so both are completed by the same request
+RequestCallback MITPBridge::chain_callbacks_(RequestCallback &&first, RequestCallback &&second) {
+  if (!first) {
+    return std::move(second);
+  }
+  if (!second) {
+    return std::move(first);
+  }
+  return [first = std::move(first), second = std::move(second)](const RequestStatus status,
+                                                                const RawPacket *response) {
+    first(status, response);
+    second(status, response);
+  };
+}
+
+void MITPBridge::queue_pop_() {
+  queue_head_ = (queue_head_ + 1) % MAX_QUEUE_SIZE;
+  queue_size_--;
 }
 
-void MITPBridge::write_raw_packet_(const RawPacket &packet_to_send) const {
+void MITPBridge::queue_remove_(const size_t index) {
+  for (size_t i = index; i + 1 < queue_size_; i++) {
+    queue_at_(i) = std::move(queue_at_(i + 1));
+  }
+  queue_size_--;
+}
+
+void MITPBridge::write_raw_packet_(const QueuedPacket &packet_to_send) {
   uart_comp_.write_array(packet_to_send.get_bytes(), packet_to_send.get_length());
+
+  if (packet_to_send.get_priority() == PacketPriority::PASSTHROUGH) {
+    record_forward_latency_(micros() - packet_to_send.get_start_micros());
+  }
+}
+
+// Whether a packet (of a type that may be forwarded) will be answered, matching the classification below
+static bool is_response_expected(const RawPacket &pkt) {
+  if ((pkt.get_packet_type() & RESPONSE_TYPE_FLAG) != 0) {
+    return false;
+  }
+  if (static_cast<PacketType>(pkt.get_packet_type()) == PacketType::SET_REQUEST) {
+    return static_cast<SetCommand>(pkt.get_command()) != SetCommand::THERMOSTAT_HELLO;
+  }
+  return true;  // Unknown packets from the thermostat are expected to get a response
+}
+
+bool MITPBridge::forward_raw_packet_(const RawPacket &pkt) {
+  uart_comp_.write_array(pkt.get_bytes(), pkt.get_length());
+  return true;
+}
+
+// Only forward if there's room in the window for another request, otherwise it has to wait in the queue
+bool HeatpumpBridge::forward_raw_packet_(const RawPacket &pkt) {
+  if (in_flight_count_ >= in_flight_window_) {
+    return false;
+  }
+
+  // Latency is recorded by the receiving bridge, so this isn't marked as a queued PASSTHROUGH packet
+  QueuedPacket packet;
+  packet.assign(pkt, is_response_expected(pkt), ControllerAssociation::THERMOSTAT, 0);
+  send_request_(std::move(packet));
+  return true;
+}
+
+void MITPBridge::record_forward_latency_(const uint32_t latency_micros) {
+  forward_latency_total_micros_ += latency_micros;
+  forward_latency_count_++;
+}
+
+void MITPBridge::take_forward_latency(uint32_t &total_micros, uint32_t &count) {
+  total_micros += forward_latency_total_micros_;
+  count += forward_latency_count_;
+  forward_latency_total_micros_ = 0;
+  forward_latency_count_ = 0;
+}
+
+/* Forwards the packet first if it can be cut-through, then decodes and processes it.  request is the request this
+packet answers, if any.*/
+void MITPBridge::dispatch_received_packet_(RawPacket &pkt, const QueuedPacket *request) {
+  if (cut_through_target_ != nullptr && cut_through_filter_(pkt)) {
+    if (cut_through_target_->forward_raw_packet_(pkt)) {
+      cut_through_target_->record_forward_latency_(micros() - rx_micros_);
+
+      // Already forwarded, so process it without a source bridge to keep it from being routed again
+      RawPacket forwarded_pkt = RawPacket(pkt.get_bytes(), pkt.get_length(), SourceBridge::NONE,
+                                          pkt.get_controller_association());
+      classify_and_process_raw_packet_(forwarded_pkt, request);
+      return;
+    }
+  }
+
+  classify_and_process_raw_packet_(pkt, request);
 }
 
 /* Reads and deserializes a packet from UART.
-Communication with heatpump is *slow*, so we need to check and make sure there are
-enough packets available before we start reading.  If there aren't enough packets,
-no packet will be returned.
-
-Even at 2400 baud, the 100ms readtimeout should be enough to read a whole payload
-after the first byte has been received though, so currently we're assuming that once
-the header is available, it's safe to call read_array without timing out and severing
-the packet.
+Communication with heatpump is *slow*, so a packet will usually arrive over several calls to loop().  Rather
+than waiting on the UART for the rest of a packet, only bytes that are already available are read and any
+partial packet is kept in rx_buffer_ until the next call.  Bytes read are deducted from byte_budget, and no more
+bytes are read once it reaches zero.
+
+Only packets with a valid checksum are returned.  If a packet fails its checksum, the buffer is resynchronized
+on the next control byte *within* the buffered bytes so that a packet following a corrupted one isn't lost.
 */
 optional<RawPacket> MITPBridge::receive_raw_packet_(const SourceBridge source_bridge,
-                                                    const ControllerAssociation controller_association) const {
+                                                    const ControllerAssociation controller_association,
+                                                    size_t &byte_budget) {
   // TODO: Can we make the source_bridge and controller_association inherent to the class instead of passed as
   // arguments?
-  uint8_t packet_bytes[PACKET_MAX_SIZE];
-  packet_bytes[0] = 0;  // Reset control byte before starting
 
-  // Drain UART until we see a control byte (times out after 100ms in UARTComponent)
-  while (uart_comp_.available() >= PACKET_HEADER_SIZE && uart_comp_.read_byte(&packet_bytes[0])) {
-    if (packet_bytes[0] == BYTE_CONTROL)
-      break;
-    // TODO: If the serial is all garbage, this may never stop-- we should have our own timeout
-  }
+  while (true) {
+    // Check if the buffer contains a complete packet
+    if (rx_length_ >= PACKET_HEADER_SIZE) {
+      const size_t packet_length = PACKET_HEADER_SIZE + rx_buffer_[PACKET_HEADER_INDEX_PAYLOAD_LENGTH] + 1;
 
-  // If we never found a control byte, we didn't receive a packet
-  if (packet_bytes[0] != BYTE_CONTROL) {
-    return nullopt;
-  }
+      if (packet_length > PACKET_MAX_SIZE) {
+        ESP_LOGW(BRIDGE_TAG, "Invalid payload length %d, discarding header.",
+                 rx_buffer_[PACKET_HEADER_INDEX_PAYLOAD_LENGTH]);
+        resync_rx_buffer_(1);
+        continue;
+      }
+
+      if (rx_length_ >= packet_length) {
+        RawPacket pkt = RawPacket(rx_buffer_, packet_length, source_bridge, controller_association);
+
+        if (pkt.is_checksum_valid()) {
+          rx_micros_ = micros();
+          resync_rx_buffer_(packet_length);
+          return pkt;
+        }
+
+        ESP_LOGW(BRIDGE_TAG, "Invalid packet checksum!\n%s", format_hex_pretty(rx_buffer_, packet_length).c_str());
+        resync_rx_buffer_(1);
+        continue;
+      }
+    }
+
+    const int available = uart_comp_.available();
+    if (byte_budget == 0 || available <= 0) {
+      return nullopt;
+    }
+
+    if (rx_length_ == 0) {
+      // Drain UART until we see a control byte
+      uint8_t byte;
+      uart_comp_.read_byte(&byte);
+      byte_budget--;
+      if (byte == BYTE_CONTROL) {
+        rx_buffer_[rx_length_++] = byte;
+      }
+      continue;
+    }
 
-  // Read the header
-  uart_comp_.read_array(&packet_bytes[1], PACKET_HEADER_SIZE - 1);
+    // Read (only) what's already available of the header, or the payload + checksum
+    const size_t wanted = rx_length_ < PACKET_HEADER_SIZE
+                              ? PACKET_HEADER_SIZE - rx_length_
+                              : PACKET_HEADER_SIZE + rx_buffer_[PACKET_HEADER_INDEX_PAYLOAD_LENGTH] + 1 - rx_length_;
+    const size_t to_read = std::min({wanted, static_cast<size_t>(available), byte_budget});
+    uart_comp_.read_array(&rx_buffer_[rx_length_], to_read);
+    rx_length_ += to_read;
+    byte_budget -= to_read;
+  }
+}
 
-  // Read payload + checksum
-  uint8_t payload_size = packet_bytes[PACKET_HEADER_INDEX_PAYLOAD_LENGTH];
-  uart_comp_.read_array(&packet_bytes[PACKET_HEADER_SIZE], payload_size + 1);
+// Discards buffered bytes before start_index, and then any further bytes until the next control byte.
+void MITPBridge::resync_rx_buffer_(const size_t start_index) {
+  size_t next_start = start_index;
+  while (next_start < rx_length_ && rx_buffer_[next_start] != BYTE_CONTROL) {
+    next_start++;
+  }
 
-  return RawPacket(packet_bytes, PACKET_HEADER_SIZE + payload_size + 1, source_bridge, controller_association);
+  rx_length_ -= next_start;
+  std::memmove(rx_buffer_, &rx_buffer_[next_start], rx_length_);
 }
 
-template<class PType> void MITPBridge::process_raw_packet_(RawPacket &pkt, bool expect_response) const {
+template<class PType>
+void MITPBridge::process_raw_packet_(RawPacket &pkt, bool expect_response, const QueuedPacket *request) const {
   static_assert(std::is_base_of_v<Packet, PType>, "PType must derive from Packet");
 
   PType packet = PType(std::move(pkt));
 
-  if (packet_awaiting_response_) {
+  if (request != nullptr) {
     // If this is a response, match up the sequence
-    packet.set_sequence(packet_awaiting_response_->get_sequence());
+    packet.set_sequence(request->get_sequence());
   }
 
   packet.set_response_expected(expect_response);
   pkt_processor_.process_packet(packet);
 }
 
-void MITPBridge::classify_and_process_raw_packet_(RawPacket &pkt) const {
+void MITPBridge::classify_and_process_raw_packet_(RawPacket &pkt, const QueuedPacket *request) const {
   // Figure out how to do this without a static_cast?
   switch (static_cast<PacketType>(pkt.get_packet_type())) {
     case PacketType::CONNECT_REQUEST:
-      process_raw_packet_<ConnectRequestPacket>(pkt, true);
+      process_raw_packet_<ConnectRequestPacket>(pkt, true, request);
       break;
     case PacketType::CONNECT_RESPONSE:
-      process_raw_packet_<ConnectResponsePacket>(pkt, false);
+      process_raw_packet_<ConnectResponsePacket>(pkt, false, request);
       break;
 
     case PacketType::IDENTIFY_REQUEST:
-      process_raw_packet_<CapabilitiesRequestPacket>(pkt, true);
+      process_raw_packet_<CapabilitiesRequestPacket>(pkt, true, request);
       break;
     case PacketType::IDENTIFY_RESPONSE:
-      process_raw_packet_<CapabilitiesResponsePacket>(pkt, false);
+      process_raw_packet_<CapabilitiesResponsePacket>(pkt, false, request);
       break;
 
     case PacketType::GET_REQUEST:
-      process_raw_packet_<GetRequestPacket>(pkt, true);
+      process_raw_packet_<GetRequestPacket>(pkt, true, request);
       break;
     case PacketType::GET_RESPONSE:
       switch (static_cast<GetCommand>(pkt.get_command())) {
         case GetCommand::SETTINGS:
-          process_raw_packet_<SettingsGetResponsePacket>(pkt, false);
+          process_raw_packet_<SettingsGetResponsePacket>(pkt, false, request);
           break;
         case GetCommand::CURRENT_TEMP:
-          process_raw_packet_<CurrentTempGetResponsePacket>(pkt, false);
+          process_raw_packet_<CurrentTempGetResponsePacket>(pkt, false, request);
           break;
         case GetCommand::ERROR_INFO:
-          process_raw_packet_<ErrorStateGetResponsePacket>(pkt, false);
+          process_raw_packet_<ErrorStateGetResponsePacket>(pkt, false, request);
           break;
         case GetCommand::RUN_STATE:
-          process_raw_packet_<RunStateGetResponsePacket>(pkt, false);
+          process_raw_packet_<RunStateGetResponsePacket>(pkt, false, request);
           break;
         case GetCommand::STATUS:
-          process_raw_packet_<StatusGetResponsePacket>(pkt, false);
+          process_raw_packet_<StatusGetResponsePacket>(pkt, false, request);
           break;
         case GetCommand::FUNCTIONS_1:
-          process_raw_packet_<Functions1GetResponsePacket>(pkt, false);
+          process_raw_packet_<Functions1GetResponsePacket>(pkt, false, request);
           break;
         case GetCommand::FUNCTIONS_2:
-          process_raw_packet_<Functions2GetResponsePacket>(pkt, false);
+          process_raw_packet_<Functions2GetResponsePacket>(pkt, false, request);
           break;
         case GetCommand::THERMOSTAT_STATE_DOWNLOAD:
-          process_raw_packet_<ThermostatStateDownloadResponsePacket>(pkt, false);
+          process_raw_packet_<ThermostatStateDownloadResponsePacket>(pkt, false, request);
           break;
         default:
-          process_raw_packet_<Packet>(pkt, false);
+          process_raw_packet_<Packet>(pkt, false, request);
       }
       break;
     case PacketType::SET_REQUEST:
       switch (static_cast<SetCommand>(pkt.get_command())) {
         case SetCommand::REMOTE_TEMPERATURE:
-          process_raw_packet_<RemoteTemperatureSetRequestPacket>(pkt, true);
+          process_raw_packet_<RemoteTemperatureSetRequestPacket>(pkt, true, request);
           break;
         case SetCommand::SETTINGS:
-          process_raw_packet_<SettingsSetRequestPacket>(pkt, true);
+          process_raw_packet_<SettingsSetRequestPacket>(pkt, true, request);
           break;
         case SetCommand::THERMOSTAT_SENSOR_STATUS:
-          process_raw_packet_<ThermostatSensorStatusPacket>(pkt, true);
+          process_raw_packet_<ThermostatSensorStatusPacket>(pkt, true, request);
           break;
         case SetCommand::THERMOSTAT_HELLO:
-          process_raw_packet_<ThermostatHelloPacket>(pkt, false);
+          process_raw_packet_<ThermostatHelloPacket>(pkt, false, request);
           break;
         case SetCommand::THERMOSTAT_STATE_UPLOAD:
-          process_raw_packet_<ThermostatStateUploadPacket>(pkt, true);
+          process_raw_packet_<ThermostatStateUploadPacket>(pkt, true, request);
           break;
         case SetCommand::THERMOSTAT_SET_AA:
-          process_raw_packet_<ThermostatAASetRequestPacket>(pkt, true);
+          process_raw_packet_<ThermostatAASetRequestPacket>(pkt, true, request);
           break;
         default:
-          process_raw_packet_<Packet>(pkt, true);
+          process_raw_packet_<Packet>(pkt, true, request);
       }
       break;
     case PacketType::SET_RESPONSE:
-      process_raw_packet_<SetResponsePacket>(pkt, false);
+      process_raw_packet_<SetResponsePacket>(pkt, false, request);
       break;
 
     default:
-      process_raw_packet_<Packet>(pkt, true);  // If we get an unknown packet from the thermostat, expect a response
+      // If we get an unknown packet from the thermostat, expect a response
+      process_raw_packet_<Packet>(pkt, true, request);
   }
 }
 
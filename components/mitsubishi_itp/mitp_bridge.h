@@ -1,9 +1,12 @@
 #pragma once
 
-#include "queue"
+#include <algorithm>
+#include <array>
+#include <functional>
 #include "esphome/components/uart/uart.h"
 #include "esphome/core/helpers.h"
 #include "itp_packetprocessor.h"
+#include "mitp_frames.h"
 
 using namespace itp_packet;
 
@@ -12,49 +15,355 @@ namespace mitsubishi_itp {
 
 static constexpr char BRIDGE_TAG[] = "mitp_bridge";
 static const uint32_t RESPONSE_TIMEOUT_MS = 3000;  // Maximum amount of time to wait for an expected response packet
+static const uint32_t MIN_RESPONSE_TIMEOUT_MS = 500;  // Lower bound for the adaptive response timeout
+static const uint8_t MAX_RETRIES = 2;                 // Number of times a timed out request is retried (if safe to)
+static const uint32_t RETRY_BACKOFF_MS = 100;  // Delay before the first retry, doubled for each subsequent retry
+// Number of distinct requests (packet type + command) a response time estimate is kept for
+static const size_t RESPONSE_TIME_TABLE_SIZE = 12;
+// Maximum number of requests that can be sent to the heat pump without waiting for their responses
+static const size_t MAX_IN_FLIGHT = 4;
+// Set in the packet type of a response, e.g. GET_REQUEST (0x42) is answered with GET_RESPONSE (0x62)
+static const uint8_t RESPONSE_TYPE_FLAG = 0x20;
 /* Maximum number of packets allowed to be queued for sending.  In some circumstances the equipment response
 time can be very slow and packets would queue up faster than they were being received.  TODO: Not sure what size this
 should be, 4ish should be enough for almost all situations, so 8 seems plenty.*/
 static const size_t MAX_QUEUE_SIZE = 8;
+/* Maximum number of bytes consumed from the UART by a single bridge loop().  This keeps the time spent in loop()
+bounded even if the line is noisy, any remaining bytes will be picked up on the next call. */
+static const size_t RX_BYTE_BUDGET = 64;
+
+/* Priority classes for queued packets, higher priorities are always sent first.  Packets of the same priority are
+sent in the order they were queued.*/
+enum class PacketPriority : uint8_t {
+  POLL = 0,            // Routine requests for updated state
+  REMOTE_TEMPERATURE,  // Remote temperature updates
+  COMMAND,             // User-initiated changes (climate calls, selects, buttons)
+  PASSTHROUGH,         // Packets relayed between the thermostat and heat pump
+};
+
+// What to do when a packet is sent while the queue is full
+enum class QueueOverflowPolicy : uint8_t {
+  DROP_NEW,      // Reject the new packet
+  EVICT_LOWEST,  // Drop the oldest queued packet of the lowest priority, if it's lower than the new packet's
+};
+
+/* How a packet is combined with an equivalent packet (same type, command and controller) that's already queued.  This
+keeps the queue from filling with stale duplicates when packets are produced faster than the line can send them.*/
+enum class CoalesceMode : uint8_t {
+  NONE,            // Always queue the new packet
+  KEEP_QUEUED,     // Don't queue the new packet, the queued one will get the same result (e.g. GET requests)
+  REPLACE_QUEUED,  // Overwrite the queued packet in place with the newer one (e.g. remote temperature)
+};
+
+// How a request ended, passed to its completion callback
+enum class RequestStatus : uint8_t {
+  SENT,        // Written, and no response was expected
+  RESPONDED,   // Its response was received (and has already been processed as usual)
+  TIMED_OUT,   // No response, even after any retries
+  DROPPED,     // Never sent (or never answered), because the queue was full or the bridge was reset
+  SUPERSEDED,  // Replaced in the queue by a newer equivalent packet, which will be sent instead
+};
+
+// Called once a request is complete.  response is only set for RESPONDED, and is only valid during the call.
+using RequestCallback = std::function<void(RequestStatus status, const RawPacket *response)>;
+
+/* A packet waiting to be sent (or waiting for its response).  Only what the bridge needs to send the packet is kept:
+either a copy of the packet's bytes, or a pointer to a ConstantFrame.  These live in a fixed pool of slots in the
+bridge, so queueing a packet with send_packet() and no callback never allocates.  A completion callback is kept in a
+std::function, which may allocate if it captures much (send_request() always wraps its callback in one that does).
+Slots are moved, never copied, as the queue is rearranged.*/
+class QueuedPacket {
+ public:
+  // Copies the bytes of packet into this slot
+  void assign(const RawPacket &packet, const bool response_expected, const ControllerAssociation controller_association,
+              const uint8_t sequence) {
+    frame_ = nullptr;
+    length_ = packet.get_length();
+    std::memcpy(bytes_, packet.get_bytes(), length_);
+    response_expected_ = response_expected;
+    controller_association_ = controller_association;
+    sequence_ = sequence;
+    retries_ = 0;
+  }
+  // Points this slot at a constant frame, these are always our own requests and always expect a response
+  void assign(const ConstantFrame &frame) {
+    frame_ = &frame;
+    length_ = frame.length;
+    response_expected_ = true;
+    controller_association_ = ControllerAssociation::MITP;
+    sequence_ = 0;
+    retries_ = 0;
+  }
+
+  const uint8_t *get_bytes() const { return frame_ ? frame_->bytes : bytes_; }
+  uint8_t get_length() const { return length_; }
+  uint8_t get_packet_type() const { return get_bytes()[PACKET_HEADER_INDEX_PACKET_TYPE]; }
+  uint8_t get_command() const { return get_bytes()[PACKET_HEADER_SIZE]; }
+  bool is_equivalent(const uint8_t packet_type, const uint8_t command,
+                     const ControllerAssociation controller_association) const {
+    return get_packet_type() == packet_type && get_command() == command &&
+           controller_association_ == controller_association;
+  }
+  bool is_response_expected() const { return response_expected_; }
+  ControllerAssociation get_controller_association() const { return controller_association_; }
+  uint8_t get_sequence() const { return sequence_; }
+  PacketPriority get_priority() const { return priority_; }
+  void set_priority(const PacketPriority priority) { priority_ = priority; }
+  // When the packet was received (for pass-through packets) or queued, forwarding latency is measured from here
+  uint32_t get_start_micros() const { return start_micros_; }
+  void set_start_micros(const uint32_t start_micros) { start_micros_ = start_micros; }
+  uint8_t get_retries() const { return retries_; }
+  // Marks this packet as a retry, not to be sent before not_before_millis
+  void set_retry(const uint8_t retries, const uint32_t not_before_millis) {
+    retries_ = retries;
+    not_before_millis_ = not_before_millis;
+  }
+  bool is_ready(const uint32_t now_millis) const {
+    return retries_ == 0 || static_cast<int32_t>(now_millis - not_before_millis_) >= 0;
+  }
+
+  // The completion callback isn't touched by assign(), it's set separately once the packet has a slot
+  void set_callback(RequestCallback &&callback) { callback_ = std::move(callback); }
+  RequestCallback take_callback() {
+    RequestCallback callback = std::move(callback_);
+    callback_ = nullptr;
+    return callback;
+  }
+  bool has_callback() const { return static_cast<bool>(callback_); }
+  // Calls the completion callback (if there is one), it's cleared first so it can only be called once
+  void complete(const RequestStatus status, const RawPacket *response = nullptr) {
+    if (RequestCallback callback = take_callback()) {
+      callback(status, response);
+    }
+  }
+
+ private:
+  const ConstantFrame *frame_ = nullptr;
+  uint8_t bytes_[PACKET_MAX_SIZE];
+  uint8_t length_ = 0;
+  bool response_expected_ = true;
+  ControllerAssociation controller_association_ = ControllerAssociation::MITP;
+  uint8_t sequence_ = 0;
+  PacketPriority priority_ = PacketPriority::COMMAND;
+  uint32_t start_micros_ = 0;
+  uint8_t retries_ = 0;
+  uint32_t not_before_millis_ = 0;
+  RequestCallback callback_;
+};
+
+/* A callback taken out of the queue (e.g. from a packet that was evicted), to be called once the queue is consistent
+again.  Callbacks may queue packets themselves, so they're never called while the queue is being rearranged.*/
+struct DeferredCompletion {
+  RequestCallback callback;
+  RequestStatus status = RequestStatus::DROPPED;
+
+  void run() {
+    if (callback) {
+      RequestCallback pending = std::move(callback);
+      callback = nullptr;
+      pending(status, nullptr);
+    }
+  }
+};
+
+/* Smoothed round-trip time for one kind of request, used to derive how long to wait for its response (the same
+approach as TCP's retransmission timer, RFC 6298).*/
+struct ResponseTimeEstimate {
+  uint8_t packet_type = 0;
+  uint8_t command = 0;
+  uint32_t smoothed_ms = 0;
+  uint32_t variation_ms = 0;
+
+  void add_sample(uint32_t sample_ms);
+  uint32_t timeout_ms() const;
+};
+
+// A request that's been sent to the heat pump and is waiting for its response
+struct InFlightRequest {
+  QueuedPacket packet;
+  uint32_t sent_millis = 0;
+  uint32_t timeout_ms = RESPONSE_TIMEOUT_MS;
+};
 
 // A UARTComponent wrapper to send and receieve packets
 class MITPBridge {
  public:
   MITPBridge(uart::UARTComponent *uart_component, PacketProcessor *packet_processor);
 
-  /* Queues a packet to be sent by the bridge.  If the queue is full, the packet will not be
-  enqueued.*/
-  template<typename PType> void send_packet(const PType &packet_to_send) {
-    static_assert(std::is_base_of_v<Packet, PType>, "PType must derive from Packet");
+  /* Queues a packet to be sent by the bridge.  The packet's bytes are copied directly into a free queue slot, or
+  coalesced with an equivalent queued packet (see coalesce_mode_()).  If the queue is full, the overflow policy decides
+  if this packet or a lower priority one is dropped.  Returns false if this packet was not queued.*/
+  template<typename PType>
+  bool send_packet(const PType &packet_to_send, const PacketPriority priority = PacketPriority::COMMAND,
+                   RequestCallback &&callback = nullptr) {
+    return queue_packet_(packet_to_send, priority, std::move(callback), micros());
+  }
+  /* Queues a pass-through packet that the other bridge received at received_micros (see get_rx_micros()), so its
+  forwarding latency is measured from the same point as a cut-through packet's.*/
+  template<typename PType> bool forward_packet(const PType &packet_to_send, const uint32_t received_micros) {
+    return queue_packet_(packet_to_send, PacketPriority::PASSTHROUGH, nullptr, received_micros);
+  }
+  // Queues a constant frame to be sent by the bridge.  Only a pointer to the frame is queued.
+  bool send_packet(const ConstantFrame &frame, const PacketPriority priority = PacketPriority::POLL,
+                   RequestCallback &&callback = nullptr) {
+    QueuedPacket *slot = nullptr;
+    DeferredCompletion displaced;
+    if (!enqueue_slot_(frame.bytes[PACKET_HEADER_INDEX_PACKET_TYPE], frame.bytes[PACKET_HEADER_SIZE],
+                       ControllerAssociation::MITP, priority, &slot, callback, displaced)) {
+      return false;
+    }
 
-    if (pkt_queue_.size() <= MAX_QUEUE_SIZE) {
-      pkt_queue_.push(std::make_unique<PType>(packet_to_send));
-    } else {
-      ESP_LOGW(BRIDGE_TAG, "Packet queue full!  %x packet not sent.", packet_to_send.get_packet_type());
+    if (slot != nullptr) {
+      slot->assign(frame);
+      slot->set_start_micros(micros());
+      slot->set_callback(std::move(callback));
     }
+    displaced.run();
+    return true;
+  }
+
+  /* Queues a request, and calls callback with its response (decoded as ResponseType) once it's answered, or with
+  nullptr and the reason it won't be.  The callback is called exactly once, from the bridge's loop() or (if the request
+  is superseded or evicted by another packet) from that packet's send_packet().  It isn't called at all if this returns
+  false, i.e. the request couldn't be queued.
+
+  If an equivalent request is already queued (e.g. a poll for the same command), the two are sent once and both
+  callbacks get its result.*/
+  template<typename ResponseType, typename RequestType>
+  bool send_request(const RequestType &request, const PacketPriority priority,
+                    std::function<void(RequestStatus, const ResponseType *)> &&callback) {
+    return send_packet(request, priority,
+                       [callback = std::move(callback)](const RequestStatus status, const RawPacket *response) {
+                         if (response == nullptr) {
+                           callback(status, nullptr);
+                           return;
+                         }
+                         const ResponseType typed_response =
+                             ResponseType(RawPacket(response->get_bytes(), response->get_length()));
+                         callback(status, &typed_response);
+                       });
+  }
+
+  void set_overflow_policy(const QueueOverflowPolicy policy) { overflow_policy_ = policy; }
+
+  /* Enables cut-through forwarding: received packets for which filter returns true are written to target as soon as
+  they pass their checksum, instead of being decoded and queued on target.  They're still decoded afterwards (with
+  SourceBridge::NONE, so they aren't routed again).*/
+  void set_cut_through(MITPBridge *target, std::function<bool(const RawPacket &)> &&filter) {
+    cut_through_target_ = target;
+    cut_through_filter_ = std::move(filter);
   }
 
+  // When the packet being processed (e.g. by a PacketProcessor) was received, i.e. passed its checksum
+  uint32_t get_rx_micros() const { return rx_micros_; }
+
+  /* Adds the time pass-through packets took to be forwarded to this bridge's UART since the last call, and resets it.
+  Latency is measured from when the packet was received by the other bridge until it was written.*/
+  void take_forward_latency(uint32_t &total_micros, uint32_t &count);
+
   // Checks for incoming packets, processes them, sends queued packets
   virtual void loop() = 0;
 
  protected:
-  optional<RawPacket> receive_raw_packet_(SourceBridge source_bridge,
-                                          ControllerAssociation controller_association) const;
-  void write_raw_packet_(const RawPacket &packet_to_send) const;
-  template<class P> void process_raw_packet_(RawPacket &pkt, bool expect_response = true) const;
-  void classify_and_process_raw_packet_(RawPacket &pkt) const;
+  template<typename PType>
+  bool queue_packet_(const PType &packet_to_send, const PacketPriority priority, RequestCallback &&callback,
+                     const uint32_t start_micros) {
+    static_assert(std::is_base_of_v<Packet, PType>, "PType must derive from Packet");
+
+    QueuedPacket *slot = nullptr;
+    DeferredCompletion displaced;
+    if (!enqueue_slot_(packet_to_send.get_packet_type(), packet_to_send.get_command(),
+                       packet_to_send.get_controller_association(), priority, &slot, callback, displaced)) {
+      return false;
+    }
+
+    if (slot != nullptr) {
+      // raw_packet() isn't const, but it's only read from here
+      slot->assign(const_cast<PType &>(packet_to_send).raw_packet(), packet_to_send.is_response_expected(),
+                   packet_to_send.get_controller_association(), packet_to_send.get_sequence());
+      slot->set_start_micros(start_micros);
+      slot->set_callback(std::move(callback));
+    }
+    displaced.run();
+    return true;
+  }
+
+  // Writes a pass-through packet immediately if possible, returns false if it should be queued instead
+  virtual bool forward_raw_packet_(const RawPacket &pkt);
+  void record_forward_latency_(uint32_t latency_micros);
+  void dispatch_received_packet_(RawPacket &pkt, const QueuedPacket *request = nullptr);
+
+  optional<RawPacket> receive_raw_packet_(SourceBridge source_bridge, ControllerAssociation controller_association,
+                                          size_t &byte_budget);
+  void resync_rx_buffer_(size_t start_index);
+  void write_raw_packet_(const QueuedPacket &packet_to_send);
+  template<class P>
+  void process_raw_packet_(RawPacket &pkt, bool expect_response = true, const QueuedPacket *request = nullptr) const;
+  void classify_and_process_raw_packet_(RawPacket &pkt, const QueuedPacket *request = nullptr) const;
 
   uart::UARTComponent &uart_comp_;
   PacketProcessor &pkt_processor_;
-  std::queue<std::unique_ptr<Packet>> pkt_queue_;
-  std::unique_ptr<Packet> packet_awaiting_response_ = nullptr;
-  uint32_t packet_sent_millis_;
+
+  // Send queue, a ring buffer over a fixed pool of slots kept in priority order
+  static CoalesceMode coalesce_mode_(uint8_t packet_type, uint8_t command);
+  static RequestCallback chain_callbacks_(RequestCallback &&first, RequestCallback &&second);
+  bool enqueue_slot_(uint8_t packet_type, uint8_t command, ControllerAssociation controller_association,
+                     PacketPriority priority, QueuedPacket **slot, RequestCallback &callback,
+                     DeferredCompletion &displaced, bool *coalesced = nullptr);
+  QueuedPacket &queue_at_(const size_t index) { return queue_slots_[(queue_head_ + index) % MAX_QUEUE_SIZE]; }
+  const QueuedPacket &queue_front_() const { return queue_slots_[queue_head_]; }
+  void queue_pop_();
+  void queue_remove_(size_t index);
+  bool queue_empty_() const { return queue_size_ == 0; }
+  std::array<QueuedPacket, MAX_QUEUE_SIZE> queue_slots_;
+  size_t queue_head_ = 0;
+  size_t queue_size_ = 0;
+  QueueOverflowPolicy overflow_policy_ = QueueOverflowPolicy::EVICT_LOWEST;
+
+  // Cut-through forwarding
+  MITPBridge *cut_through_target_ = nullptr;
+  std::function<bool(const RawPacket &)> cut_through_filter_;
+  uint32_t forward_latency_total_micros_ = 0;
+  uint32_t forward_latency_count_ = 0;
+
+  // Partially received frame, kept between calls to receive_raw_packet_
+  uint8_t rx_buffer_[PACKET_MAX_SIZE];
+  size_t rx_length_ = 0;
+  uint32_t rx_micros_ = 0;
 };
 
 class HeatpumpBridge : public MITPBridge {
  public:
   using MITPBridge::MITPBridge;
   void loop() override;
+
+  // Sets how many requests can be in flight at once (1 to MAX_IN_FLIGHT)
+  void set_in_flight_window(uint8_t window);
+
+  // Link health: requests in a row that got no response (after any retries), and when a packet was last received
+  uint8_t get_consecutive_timeouts() const { return consecutive_timeouts_; }
+  uint32_t get_last_rx_millis() const { return last_rx_millis_; }
+  // Drops everything queued or in flight (e.g. once the heat pump has stopped responding), and resets link health
+  void reset();
+
+ protected:
+  bool forward_raw_packet_(const RawPacket &pkt) override;
+  void send_request_(QueuedPacket &&packet);
+  int find_in_flight_(const RawPacket &pkt) const;
+  void remove_in_flight_(size_t index);
+  void retry_request_(QueuedPacket &&request);
+  static bool is_retryable_(const QueuedPacket &packet);
+  ResponseTimeEstimate *find_estimate_(uint8_t packet_type, uint8_t command, bool create);
+
+  // Requests waiting for a response, oldest first
+  std::array<InFlightRequest, MAX_IN_FLIGHT> in_flight_;
+  size_t in_flight_count_ = 0;
+  uint8_t in_flight_window_ = 1;
+  std::array<ResponseTimeEstimate, RESPONSE_TIME_TABLE_SIZE> response_time_estimates_;
+  size_t response_time_estimate_count_ = 0;
+
+  uint8_t consecutive_timeouts_ = 0;
+  uint32_t last_rx_millis_ = 0;
 };
 
 class ThermostatBridge : public MITPBridge {
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstring>
+#include "itp_packets.h"
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+// A complete, pre-serialized packet (including checksum) that never changes, used for our constant requests so they
+// can be sent straight from read-only memory without building a Packet.
+struct ConstantFrame {
+  uint8_t bytes[itp_packet::PACKET_MAX_SIZE];
+  uint8_t length;
+};
+
+// Builds a ConstantFrame at compile time.  Payload bytes beyond the first two are zero.
+constexpr ConstantFrame make_constant_frame(const itp_packet::PacketType packet_type, const uint8_t payload_size,
+                                            const uint8_t payload_0, const uint8_t payload_1 = 0x00) {
+  ConstantFrame frame{};
+  frame.bytes[0] = itp_packet::BYTE_CONTROL;
+  frame.bytes[itp_packet::PACKET_HEADER_INDEX_PACKET_TYPE] = static_cast<uint8_t>(packet_type);
+  frame.bytes[2] = 0x01;  // Header bytes 2 and 3 are always 0x01 0x30
+  frame.bytes[3] = 0x30;
+  frame.bytes[itp_packet::PACKET_HEADER_INDEX_PAYLOAD_LENGTH] = payload_size;
+  frame.bytes[itp_packet::PACKET_HEADER_SIZE] = payload_0;
+  frame.bytes[itp_packet::PACKET_HEADER_SIZE + 1] = payload_1;
+  frame.length = itp_packet::PACKET_HEADER_SIZE + payload_size + 1;
+
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < frame.length - 1; i++) {
+    sum += frame.bytes[i];
+  }
+  frame.bytes[frame.length - 1] = static_cast<uint8_t>(itp_packet::BYTE_CONTROL - sum);
+
+  return frame;
+}
+
+constexpr ConstantFrame make_get_request_frame(const itp_packet::GetCommand command) {
+  return make_constant_frame(itp_packet::PacketType::GET_REQUEST, 0x10, static_cast<uint8_t>(command));
+}
+
+inline constexpr ConstantFrame CONNECT_REQUEST_FRAME =
+    make_constant_frame(itp_packet::PacketType::CONNECT_REQUEST, 0x02, 0xca, 0x01);
+inline constexpr ConstantFrame CAPABILITIES_REQUEST_FRAME =
+    make_constant_frame(itp_packet::PacketType::IDENTIFY_REQUEST, 0x01, 0xc9);
+
+inline constexpr ConstantFrame GET_SETTINGS_FRAME = make_get_request_frame(itp_packet::GetCommand::SETTINGS);
+inline constexpr ConstantFrame GET_CURRENT_TEMP_FRAME = make_get_request_frame(itp_packet::GetCommand::CURRENT_TEMP);
+inline constexpr ConstantFrame GET_ERROR_INFO_FRAME = make_get_request_frame(itp_packet::GetCommand::ERROR_INFO);
+inline constexpr ConstantFrame GET_STATUS_FRAME = make_get_request_frame(itp_packet::GetCommand::STATUS);
+inline constexpr ConstantFrame GET_RUN_STATE_FRAME = make_get_request_frame(itp_packet::GetCommand::RUN_STATE);
+
+// Whether a frame has the same bytes as a packet built by the itp_packet library
+inline bool frame_matches(const ConstantFrame &frame, itp_packet::Packet &packet) {
+  const itp_packet::RawPacket &raw = packet.raw_packet();
+  return frame.length == raw.get_length() && std::memcmp(frame.bytes, raw.get_bytes(), frame.length) == 0;
+}
+
+/* The frames above are encoded by hand (so they can be built at compile time), but the library can't build packets at
+compile time to check them against.  Returns the name of the first frame that differs from the library's packet for the
+same request, or nullptr if they all match.*/
+inline const char *find_mismatched_constant_frame() {
+  using namespace itp_packet;
+  if (!frame_matches(CONNECT_REQUEST_FRAME, ConnectRequestPacket::instance())) {
+    return "connect request";
+  }
+  if (!frame_matches(CAPABILITIES_REQUEST_FRAME, CapabilitiesRequestPacket::instance())) {
+    return "capabilities request";
+  }
+  if (!frame_matches(GET_SETTINGS_FRAME, GetRequestPacket::get_settings_instance())) {
+    return "get settings";
+  }
+  if (!frame_matches(GET_CURRENT_TEMP_FRAME, GetRequestPacket::get_current_temp_instance())) {
+    return "get current temperature";
+  }
+  if (!frame_matches(GET_ERROR_INFO_FRAME, GetRequestPacket::get_error_info_instance())) {
+    return "get error info";
+  }
+  if (!frame_matches(GET_STATUS_FRAME, GetRequestPacket::get_status_instance())) {
+    return "get status";
+  }
+  if (!frame_matches(GET_RUN_STATE_FRAME, GetRequestPacket::get_runstate_instance())) {
+    return "get run state";
+  }
+  return nullptr;
+}
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
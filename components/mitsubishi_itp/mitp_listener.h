@@ -1,18 +1,99 @@
 #pragma once
 
 #include "itp_packetprocessor.h"
+#include "mitp_state.h"
 
 namespace esphome {
 namespace mitsubishi_itp {
 
 static constexpr char LISTENER_TAG[] = "mitsubishi_itp.listener";
 
+// Packets (and other events) the hub passes on to listeners.  Listeners subscribe to the ones they handle.
+enum ListenerEvent : uint8_t {
+  LISTENER_EVENT_SETTINGS_GET_RESPONSE = 0,
+  LISTENER_EVENT_CURRENT_TEMP_GET_RESPONSE,
+  LISTENER_EVENT_STATUS_GET_RESPONSE,
+  LISTENER_EVENT_RUN_STATE_GET_RESPONSE,
+  LISTENER_EVENT_ERROR_STATE_GET_RESPONSE,
+  LISTENER_EVENT_SETTINGS_SET_REQUEST,
+  LISTENER_EVENT_REMOTE_TEMPERATURE_SET_REQUEST,
+  LISTENER_EVENT_THERMOSTAT_SENSOR_STATUS,
+  LISTENER_EVENT_USING_INTERNAL_TEMPERATURE,
+  LISTENER_EVENT_PASSTHROUGH_LATENCY,
+  LISTENER_EVENT_PREFERENCE_SAVES,
+  LISTENER_EVENT_LINK_STATE,
+  LISTENER_EVENT_COMMAND_RESULT,
+  LISTENER_EVENT_COUNT,
+};
+
+constexpr uint32_t listener_event_bit(const ListenerEvent event) { return 1 << event; }
+static const uint32_t LISTENER_EVENTS_NONE = 0;
+static const uint32_t LISTENER_EVENTS_ALL = (1 << LISTENER_EVENT_COUNT) - 1;
+
+// The event a packet type is passed to listeners as
+template<typename T> constexpr ListenerEvent listener_event_of();
+template<> constexpr ListenerEvent listener_event_of<itp_packet::SettingsGetResponsePacket>() {
+  return LISTENER_EVENT_SETTINGS_GET_RESPONSE;
+}
+template<> constexpr ListenerEvent listener_event_of<itp_packet::CurrentTempGetResponsePacket>() {
+  return LISTENER_EVENT_CURRENT_TEMP_GET_RESPONSE;
+}
+template<> constexpr ListenerEvent listener_event_of<itp_packet::StatusGetResponsePacket>() {
+  return LISTENER_EVENT_STATUS_GET_RESPONSE;
+}
+template<> constexpr ListenerEvent listener_event_of<itp_packet::RunStateGetResponsePacket>() {
+  return LISTENER_EVENT_RUN_STATE_GET_RESPONSE;
+}
+template<> constexpr ListenerEvent listener_event_of<itp_packet::ErrorStateGetResponsePacket>() {
+  return LISTENER_EVENT_ERROR_STATE_GET_RESPONSE;
+}
+template<> constexpr ListenerEvent listener_event_of<itp_packet::SettingsSetRequestPacket>() {
+  return LISTENER_EVENT_SETTINGS_SET_REQUEST;
+}
+template<> constexpr ListenerEvent listener_event_of<itp_packet::RemoteTemperatureSetRequestPacket>() {
+  return LISTENER_EVENT_REMOTE_TEMPERATURE_SET_REQUEST;
+}
+template<> constexpr ListenerEvent listener_event_of<itp_packet::ThermostatSensorStatusPacket>() {
+  return LISTENER_EVENT_THERMOSTAT_SENSOR_STATUS;
+}
+
+// What the heat pump did with a settings change, once its settings were read back (see confirm_settings_())
+enum class CommandResult : uint8_t {
+  ACCEPTED,    // Applied as sent
+  ADJUSTED,    // Acknowledged, but the settings read back differ from what was sent
+  REJECTED,    // The heat pump responded with a failure
+  UNANSWERED,  // The change (or the read back) timed out, or was dropped
+};
+inline const char *const COMMAND_RESULT_NAMES[] = {"Accepted", "Adjusted", "Rejected", "Unanswered"};
+
 class MITPListener : public itp_packet::PacketProcessor {
  public:
   virtual void publish() = 0;  // Publish only if the underlying state has changed
+  // The state fields (StateField bits) this listener publishes, publish() is only called when one of them changes
+  virtual uint32_t get_state_fields() const { return STATE_FIELDS_ALL; }
+  // Of those fields, the ones this listener needs publish() called for on every update, even if the value is the same
+  virtual uint32_t get_sampled_fields() const { return STATE_FIELDS_NONE; }
+  // The events (listener_event_bit()s) this listener handles, it's only passed these
+  virtual uint32_t get_subscriptions() const { return LISTENER_EVENTS_ALL; }
+  // Returns false if this listener was already woken to publish this version of the state
+  bool wake(const uint32_t version) {
+    if (woken_version_ == version) {
+      return false;
+    }
+    woken_version_ = version;
+    return true;
+  }
 
   virtual void setup(){};  // Called during hub-component setup();
   virtual void using_internal_temperature(const bool using_internal){};
+  virtual void passthrough_latency(const float latency_ms){};  // Average forwarding latency since the last update
+  virtual void preference_saves(const uint32_t saves){};     // Preferences saved since boot
+  // Whether the heat pump is responding, and how many times its link has been lost (and reconnected) since boot
+  virtual void link_state(const bool connected, const uint32_t reconnects){};
+  virtual void command_result(const CommandResult result){};  // Of the last settings change
+
+ protected:
+  uint32_t woken_version_ = 0;
 };
 
 }  // namespace mitsubishi_itp
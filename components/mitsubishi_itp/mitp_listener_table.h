@@ -0,0 +1,159 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include "mitp_listener.h"
+
+using namespace itp_packet;
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+/* A set of listeners the hub dispatches to with a single call per event, instead of calling each listener itself.  See
+StaticListenerTable, which codegen creates (instead of registering each listener) when static_listeners is enabled.*/
+class ListenerTable : public PacketProcessor {
+ public:
+  virtual void setup() = 0;
+  virtual uint32_t get_sampled_fields() const = 0;
+  virtual void publish(uint32_t changed_fields) = 0;
+  virtual void using_internal_temperature(bool using_internal) = 0;
+  virtual void passthrough_latency(float latency_ms) = 0;
+  virtual void preference_saves(uint32_t saves) = 0;
+  virtual void link_state(bool connected, uint32_t reconnects) = 0;
+  virtual void command_result(CommandResult result) = 0;
+};
+
+namespace listener_traits {
+
+// The class a member function was declared in (for &L::f, the base class that declares f if L doesn't)
+template<typename C, typename R, typename... Args> C *declaring_class(R (C::*)(Args...));
+template<typename T, typename C> C *declaring_class_of_handler(void (C::*)(const T &));
+
+// True if L declares its own (public) process_packet(const T &), rather than inheriting PacketProcessor's empty one
+template<typename L, typename T, typename = void> struct has_packet_handler : std::false_type {};
+template<typename L, typename T>
+struct has_packet_handler<L, T, std::void_t<decltype(declaring_class_of_handler<T>(&L::process_packet))>>
+    : std::bool_constant<!std::is_same_v<decltype(declaring_class_of_handler<T>(&L::process_packet)),
+                                         PacketProcessor *>> {};
+
+template<typename L>
+constexpr bool handles_internal_temperature =
+    !std::is_same_v<decltype(declaring_class(&L::using_internal_temperature)), MITPListener *>;
+template<typename L>
+constexpr bool handles_passthrough_latency =
+    !std::is_same_v<decltype(declaring_class(&L::passthrough_latency)), MITPListener *>;
+template<typename L>
+constexpr bool handles_preference_saves =
+    !std::is_same_v<decltype(declaring_class(&L::preference_saves)), MITPListener *>;
+template<typename L>
+constexpr bool handles_link_state = !std::is_same_v<decltype(declaring_class(&L::link_state)), MITPListener *>;
+template<typename L>
+constexpr bool handles_command_result =
+    !std::is_same_v<decltype(declaring_class(&L::command_result)), MITPListener *>;
+
+}  // namespace listener_traits
+
+/* Dispatches to a fixed set of listeners whose types are known at compile time.  Every call is qualified with the
+listener's concrete type, so none of them go through the vtable, and packets are only passed to listeners that
+actually declare a handler for them (the check happens at compile time, so there's no cost for the others).
+
+Handlers need to be public for this to find them.*/
+template<typename... Ls> class StaticListenerTable : public ListenerTable {
+ public:
+  explicit StaticListenerTable(Ls *...listeners) : listeners_(listeners...) {}
+
+  void process_packet(const SettingsGetResponsePacket &packet) override { alert_(packet); }
+  void process_packet(const CurrentTempGetResponsePacket &packet) override { alert_(packet); }
+  void process_packet(const StatusGetResponsePacket &packet) override { alert_(packet); }
+  void process_packet(const RunStateGetResponsePacket &packet) override { alert_(packet); }
+  void process_packet(const ErrorStateGetResponsePacket &packet) override { alert_(packet); }
+  void process_packet(const SettingsSetRequestPacket &packet) override { alert_(packet); }
+  void process_packet(const RemoteTemperatureSetRequestPacket &packet) override { alert_(packet); }
+  void process_packet(const ThermostatSensorStatusPacket &packet) override { alert_(packet); }
+
+  void setup() override {
+    for_each_([](auto *listener) {
+      using L = std::remove_pointer_t<decltype(listener)>;
+      listener->L::setup();
+    });
+  }
+
+  uint32_t get_sampled_fields() const override {
+    uint32_t fields = STATE_FIELDS_NONE;
+    std::apply([&fields](Ls *...listeners) { ((fields |= listeners->Ls::get_sampled_fields()), ...); }, listeners_);
+    return fields;
+  }
+
+  void publish(const uint32_t changed_fields) override {
+    for_each_([changed_fields](auto *listener) {
+      using L = std::remove_pointer_t<decltype(listener)>;
+      if (changed_fields & listener->L::get_state_fields()) {
+        listener->L::publish();
+      }
+    });
+  }
+
+  void using_internal_temperature(const bool using_internal) override {
+    for_each_([using_internal](auto *listener) {
+      using L = std::remove_pointer_t<decltype(listener)>;
+      if constexpr (listener_traits::handles_internal_temperature<L>) {
+        listener->L::using_internal_temperature(using_internal);
+      }
+    });
+  }
+
+  void passthrough_latency(const float latency_ms) override {
+    for_each_([latency_ms](auto *listener) {
+      using L = std::remove_pointer_t<decltype(listener)>;
+      if constexpr (listener_traits::handles_passthrough_latency<L>) {
+        listener->L::passthrough_latency(latency_ms);
+      }
+    });
+  }
+
+  void preference_saves(const uint32_t saves) override {
+    for_each_([saves](auto *listener) {
+      using L = std::remove_pointer_t<decltype(listener)>;
+      if constexpr (listener_traits::handles_preference_saves<L>) {
+        listener->L::preference_saves(saves);
+      }
+    });
+  }
+
+  void link_state(const bool connected, const uint32_t reconnects) override {
+    for_each_([connected, reconnects](auto *listener) {
+      using L = std::remove_pointer_t<decltype(listener)>;
+      if constexpr (listener_traits::handles_link_state<L>) {
+        listener->L::link_state(connected, reconnects);
+      }
+    });
+  }
+
+  void command_result(const CommandResult result) override {
+    for_each_([result](auto *listener) {
+      using L = std::remove_pointer_t<decltype(listener)>;
+      if constexpr (listener_traits::handles_command_result<L>) {
+        listener->L::command_result(result);
+      }
+    });
+  }
+
+ protected:
+  template<typename F> void for_each_(F &&f) {
+    std::apply([&f](Ls *...listeners) { (f(listeners), ...); }, listeners_);
+  }
+
+  template<typename T> void alert_(const T &packet) {
+    for_each_([&packet](auto *listener) {
+      using L = std::remove_pointer_t<decltype(listener)>;
+      if constexpr (listener_traits::has_packet_handler<L, T>::value) {
+        listener->L::process_packet(packet);
+      }
+    });
+  }
+
+  std::tuple<Ls *...> listeners_;
+};
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include "esphome/core/optional.h"
+#include "itp_packets.h"
+
+using namespace itp_packet;
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+template<typename E> struct Option {
+  E value;
+  const char *label;
+};
+
+/* Maps a setting between its packet byte, its index and its label.  Tables are in the same order as the options of
+the select that controls the setting (see select/__init__.py), so an index here is also the select's option index.
+Lookups by value only compare bytes, so labels are only needed when a change is actually published.*/
+template<typename E, size_t N> struct OptionTable {
+  Option<E> options[N];
+
+  static constexpr size_t size() { return N; }
+  constexpr bool has_index(const size_t index) const { return index < N; }
+  constexpr E value_at(const size_t index) const { return options[index].value; }
+  constexpr const char *label_at(const size_t index) const { return options[index].label; }
+
+  optional<size_t> index_of(const E value) const {
+    for (size_t i = 0; i < N; i++) {
+      if (options[i].value == value) {
+        return i;
+      }
+    }
+    return nullopt;
+  }
+  optional<size_t> index_of(const std::string &label) const {
+    for (size_t i = 0; i < N; i++) {
+      if (strcmp(options[i].label, label.c_str()) == 0) {
+        return i;
+      }
+    }
+    return nullopt;
+  }
+};
+
+// Must match VANE_POSITIONS in select/__init__.py
+inline constexpr OptionTable<SettingsSetRequestPacket::VaneByte, 7> VANE_POSITION_OPTIONS = {{
+    {SettingsSetRequestPacket::VANE_AUTO, "Auto"},
+    {SettingsSetRequestPacket::VANE_1, "1"},
+    {SettingsSetRequestPacket::VANE_2, "2"},
+    {SettingsSetRequestPacket::VANE_3, "3"},
+    {SettingsSetRequestPacket::VANE_4, "4"},
+    {SettingsSetRequestPacket::VANE_5, "5"},
+    {SettingsSetRequestPacket::VANE_SWING, "Swing"},
+}};
+
+// Must match HORIZONTAL_VANE_POSITIONS in select/__init__.py
+inline constexpr OptionTable<SettingsSetRequestPacket::HorizontalVaneByte, 8> HORIZONTAL_VANE_POSITION_OPTIONS = {{
+    {SettingsSetRequestPacket::HV_AUTO, "Auto"},
+    {SettingsSetRequestPacket::HV_LEFT_FULL, "<<"},
+    {SettingsSetRequestPacket::HV_LEFT, "<"},
+    {SettingsSetRequestPacket::HV_CENTER, "|"},
+    {SettingsSetRequestPacket::HV_RIGHT, ">"},
+    {SettingsSetRequestPacket::HV_RIGHT_FULL, ">>"},
+    {SettingsSetRequestPacket::HV_SPLIT, "<>"},
+    {SettingsSetRequestPacket::HV_SWING, "Swing"},
+}};
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
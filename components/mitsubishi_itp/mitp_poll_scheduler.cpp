@@ -0,0 +1,121 @@
+#include "mitp_poll_scheduler.h"
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+static constexpr char POLL_TAG[] = "mitp_poll";
+
+void PollScheduler::set_interval(const GetCommand command, const uint32_t interval_ms) {
+  PollEntry *entry = find_entry_(command);
+  if (entry != nullptr) {
+    entry->interval_ms = interval_ms;
+  }
+}
+
+void PollScheduler::boost(const uint32_t now) {
+  if (boost_duration_ms_ == 0) {
+    return;
+  }
+  boosting_ = true;
+  boost_started_millis_ = now;
+}
+
+void PollScheduler::mark_answered(const GetCommand command) {
+  PollEntry *entry = find_entry_(command);
+  if (entry != nullptr) {
+    entry->answered = true;
+    entry->probing = false;
+    entry->unanswered_polls = 0;
+  }
+}
+
+void PollScheduler::poll(MITPBridge &bridge, const uint32_t now) {
+  if (boosting_ && now - boost_started_millis_ > boost_duration_ms_) {
+    boosting_ = false;
+  }
+
+  // Only give up on commands if the unit is answering something, otherwise it's probably just not connected
+  const bool unit_answering = entries_[0].answered;
+
+  for (PollEntry &entry : entries_) {
+    if (!entry.supported) {
+      continue;
+    }
+    if (entry.polled && now - entry.last_poll_millis < effective_interval_(entry)) {
+      continue;
+    }
+
+    const uint8_t max_unanswered_polls = entry.probing ? 1 : MAX_UNANSWERED_POLLS;
+    if (!entry.answered && unit_answering && entry.unanswered_polls >= max_unanswered_polls) {
+      ESP_LOGI(POLL_TAG, "GetCommand %x was never answered, assuming it's not supported.",
+               static_cast<uint8_t>(entry.command));
+      entry.supported = false;
+      entry.probing = false;
+      continue;
+    }
+
+    // The attempt counts even if the queue is full, so it's retried next interval rather than on every loop()
+    entry.last_poll_millis = now;
+    entry.polled = true;
+    if (bridge.send_packet(*entry.frame, PacketPriority::POLL) && entry.unanswered_polls < MAX_UNANSWERED_POLLS) {
+      entry.unanswered_polls++;
+    }
+  }
+}
+
+void PollScheduler::restart() {
+  for (PollEntry &entry : entries_) {
+    entry.polled = false;
+    entry.unanswered_polls = 0;
+  }
+}
+
+uint8_t PollScheduler::get_unsupported() const {
+  uint8_t unsupported = 0;
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if (!entries_[i].supported || entries_[i].probing) {
+      unsupported |= 1 << i;
+    }
+  }
+  return unsupported;
+}
+
+void PollScheduler::set_unsupported(const uint8_t unsupported) {
+  for (size_t i = 0; i < entries_.size(); i++) {
+    if ((unsupported & (1 << i)) && !entries_[i].answered) {
+      ESP_LOGI(POLL_TAG, "GetCommand %x wasn't supported last boot, checking once.",
+               static_cast<uint8_t>(entries_[i].command));
+      entries_[i].probing = true;
+    }
+  }
+}
+
+void PollScheduler::clear_unsupported() {
+  for (PollEntry &entry : entries_) {
+    entry.supported = true;
+    entry.probing = false;
+    entry.unanswered_polls = 0;
+  }
+}
+
+PollScheduler::PollEntry *PollScheduler::find_entry_(const GetCommand command) {
+  for (PollEntry &entry : entries_) {
+    if (entry.command == command) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+uint32_t PollScheduler::effective_interval_(const PollEntry &entry) const {
+  if (boosting_ && entry.boostable && boost_interval_ms_ > 0) {
+    return std::min(entry.interval_ms, boost_interval_ms_);
+  }
+  if (!powered_ && entry.slow_when_off && off_interval_ms_ > 0) {
+    return std::max(entry.interval_ms, off_interval_ms_);
+  }
+  return entry.interval_ms;
+}
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
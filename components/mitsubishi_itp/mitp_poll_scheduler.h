@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include "mitp_bridge.h"
+#include "mitp_frames.h"
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+/* Number of polls a command can go unanswered (while other polls are answered) before it's assumed the unit doesn't
+support it and it's no longer polled.*/
+static const uint8_t MAX_UNANSWERED_POLLS = 5;
+
+/* Decides when each GET request is sent to the heat pump.  Each command has its own interval, so things that rarely
+change (e.g. error info) don't take up line time every update.  Polling slows down while the unit is off, and speeds
+up for a while after a change is seen (so the result of a command is picked up quickly).*/
+class PollScheduler {
+ public:
+  void set_interval(GetCommand command, uint32_t interval_ms);
+  // Interval used (at least) for everything but settings while the unit is off, 0 to poll as normal
+  void set_off_interval(const uint32_t interval_ms) { off_interval_ms_ = interval_ms; }
+  // Interval used (at most) for settings, status and run state for duration_ms after a change, 0 to disable
+  void set_boost(const uint32_t interval_ms, const uint32_t duration_ms) {
+    boost_interval_ms_ = interval_ms;
+    boost_duration_ms_ = duration_ms;
+  }
+
+  void set_powered(const bool powered) { powered_ = powered; }
+  // Polls faster for a while, e.g. after a change to the settings
+  void boost(uint32_t now);
+  // Called when a response to command is received
+  void mark_answered(GetCommand command);
+  // Queues any polls that are due
+  void poll(MITPBridge &bridge, uint32_t now);
+  // Makes every poll due right away, e.g. after reconnecting (polls that went unanswered while the link was down
+  // don't count against their command)
+  void restart();
+
+  // Commands found not to be supported (a bit per entry), so they don't need to be rediscovered after a restart.  What's
+  // set is only a hint: each of those commands is still polled once, and kept if it's answered (e.g. after a firmware
+  // update).  They count as unsupported until then.
+  uint8_t get_unsupported() const;
+  void set_unsupported(uint8_t unsupported);
+  // Rediscovers what's supported from scratch, e.g. once it's known to be a different unit
+  void clear_unsupported();
+
+ protected:
+  struct PollEntry {
+    GetCommand command;
+    const ConstantFrame *frame;
+    uint32_t interval_ms;
+    bool boostable;      // Polled faster after a change
+    bool slow_when_off;  // Polled less often when the unit is off
+    uint32_t last_poll_millis = 0;
+    bool polled = false;
+    bool answered = false;  // Has this command ever been answered?
+    bool supported = true;  // Set false if this command never gets answered
+    bool probing = false;   // Was unsupported last boot, so it's only given one poll to be answered
+    uint8_t unanswered_polls = 0;
+  };
+
+  PollEntry *find_entry_(GetCommand command);
+  uint32_t effective_interval_(const PollEntry &entry) const;
+
+  // Settings needs to be polled before status (when both are due) for mode logic to work
+  std::array<PollEntry, 5> entries_ = {{
+      {GetCommand::SETTINGS, &GET_SETTINGS_FRAME, 5000, true, false},
+      {GetCommand::RUN_STATE, &GET_RUN_STATE_FRAME, 5000, true, true},
+      {GetCommand::STATUS, &GET_STATUS_FRAME, 5000, true, true},
+      {GetCommand::CURRENT_TEMP, &GET_CURRENT_TEMP_FRAME, 10000, false, true},
+      {GetCommand::ERROR_INFO, &GET_ERROR_INFO_FRAME, 60000, false, true},
+  }};
+
+  uint32_t off_interval_ms_ = 60000;
+  uint32_t boost_interval_ms_ = 1000;
+  uint32_t boost_duration_ms_ = 15000;
+  uint32_t boost_started_millis_ = 0;
+  bool boosting_ = false;
+  bool powered_ = true;
+};
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstring>
+#include "esphome/core/preferences.h"
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+// A preference whose value is changed in memory, and only written when committed (see MitsubishiUART)
+class DirtyPreference {
+ public:
+  bool is_dirty() const { return dirty_; }
+  // Writes the value if it's changed since the last commit.  Returns true if it was written.
+  virtual bool commit() = 0;
+
+ protected:
+  bool dirty_ = false;
+};
+
+/* Holds the value of a preference, so changing it only compares bytes in memory.  Nothing is serialized or saved until
+it's committed, so a burst of changes (e.g. dragging a setpoint) becomes a single write.*/
+template<typename T> class DebouncedPreference : public DirtyPreference {
+ public:
+  void init(const ESPPreferenceObject &object) { object_ = object; }
+  // Loads the saved value, returning false (and leaving the value unchanged) if there wasn't one
+  bool load() { return object_.load(&value_); }
+
+  const T &get() const { return value_; }
+  // Returns true if the value changed (and so needs committing)
+  bool set(const T &value) {
+    if (memcmp(&value, &value_, sizeof(T)) == 0) {
+      return false;
+    }
+    value_ = value;
+    dirty_ = true;
+    return true;
+  }
+
+  bool commit() override {
+    if (!dirty_) {
+      return false;
+    }
+    dirty_ = false;
+    return object_.save(&value_);
+  }
+
+ protected:
+  ESPPreferenceObject object_;
+  T value_{};
+};
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
@@ -0,0 +1,79 @@
+#include "mitp_response_cache.h"
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+void ResponseCache::set_ttl(const GetCommand command, const uint32_t ttl_ms) {
+  CacheEntry *entry = find_entry_(static_cast<uint8_t>(command));
+  if (entry != nullptr) {
+    entry->ttl_ms = ttl_ms;
+  }
+}
+
+void ResponseCache::store(const RawPacket &response, const uint32_t now) {
+  if (static_cast<PacketType>(response.get_packet_type()) != PacketType::GET_RESPONSE) {
+    return;
+  }
+  CacheEntry *entry = find_entry_(response.get_command());
+  if (entry == nullptr) {
+    return;
+  }
+
+  entry->length = response.get_length();
+  std::memcpy(entry->bytes, response.get_bytes(), entry->length);
+  entry->received_millis = now;
+}
+
+bool ResponseCache::lookup(const uint8_t command, const uint32_t now, uint8_t (&bytes)[PACKET_MAX_SIZE],
+                           uint8_t &length) const {
+  const CacheEntry *entry = find_fresh_(command, now);
+  if (entry == nullptr) {
+    return false;
+  }
+
+  length = entry->length;
+  std::memcpy(bytes, entry->bytes, length);
+  return true;
+}
+
+bool ResponseCache::is_fresh(const uint8_t command, const uint32_t now) const {
+  return find_fresh_(command, now) != nullptr;
+}
+
+void ResponseCache::invalidate(const GetCommand command) {
+  CacheEntry *entry = find_entry_(static_cast<uint8_t>(command));
+  if (entry != nullptr) {
+    entry->length = 0;
+  }
+}
+
+void ResponseCache::clear() {
+  for (CacheEntry &entry : entries_) {
+    entry.length = 0;
+  }
+}
+
+ResponseCache::CacheEntry *ResponseCache::find_entry_(const uint8_t command) {
+  for (CacheEntry &entry : entries_) {
+    if (static_cast<uint8_t>(entry.command) == command) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+const ResponseCache::CacheEntry *ResponseCache::find_fresh_(const uint8_t command, const uint32_t now) const {
+  for (const CacheEntry &entry : entries_) {
+    if (static_cast<uint8_t>(entry.command) != command) {
+      continue;
+    }
+    if (entry.length == 0 || entry.ttl_ms == 0 || now - entry.received_millis > entry.ttl_ms) {
+      return nullptr;
+    }
+    return &entry;
+  }
+  return nullptr;
+}
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include "itp_packets.h"
+
+using namespace itp_packet;
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+/* The last response the heat pump gave to each of the GET requests a thermostat polls for, so the thermostat can be
+answered without waiting on the heat pump (which is already being polled for the same things).  Each command has its
+own TTL, and a response older than that isn't used.  Responses are kept as raw bytes, so answering is just a copy.*/
+class ResponseCache {
+ public:
+  // 0 to never answer command from the cache
+  void set_ttl(GetCommand command, uint32_t ttl_ms);
+
+  // Keeps a GET response from the heat pump (whoever it was for), if it's for a cached command
+  void store(const RawPacket &response, uint32_t now);
+  // Returns true and copies the response to command into bytes/length if there's a fresh one
+  bool lookup(uint8_t command, uint32_t now, uint8_t (&bytes)[PACKET_MAX_SIZE], uint8_t &length) const;
+  bool is_fresh(uint8_t command, uint32_t now) const;
+
+  // Called when the heat pump's answer will have changed (e.g. its settings were set)
+  void invalidate(GetCommand command);
+  void clear();
+
+ protected:
+  struct CacheEntry {
+    GetCommand command;
+    uint32_t ttl_ms;
+    uint8_t bytes[PACKET_MAX_SIZE] = {};
+    uint8_t length = 0;  // 0 if nothing's cached
+    uint32_t received_millis = 0;
+  };
+
+  CacheEntry *find_entry_(uint8_t command);
+  const CacheEntry *find_fresh_(uint8_t command, uint32_t now) const;
+
+  // TTLs are twice the default poll intervals, so an entry is normally refreshed by polling before it expires
+  std::array<CacheEntry, 4> entries_ = {{
+      {GetCommand::SETTINGS, 10000},
+      {GetCommand::RUN_STATE, 10000},
+      {GetCommand::STATUS, 10000},
+      {GetCommand::CURRENT_TEMP, 20000},
+  }};
+};
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
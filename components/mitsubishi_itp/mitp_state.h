@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+/* Fields of the heat pump (and thermostat) state.  Each is a bit in the state's change mask, so listeners can bind to
+any combination of them.*/
+enum StateField : uint32_t {
+  // Settings
+  STATE_POWER = 1 << 0,
+  STATE_MODE = 1 << 1,
+  STATE_TARGET_TEMPERATURE = 1 << 2,
+  STATE_FAN = 1 << 3,
+  STATE_VANE = 1 << 4,
+  STATE_HORIZONTAL_VANE = 1 << 5,
+  STATE_ISEE = 1 << 6,
+  // Temperatures
+  STATE_CURRENT_TEMPERATURE = 1 << 7,
+  STATE_OUTDOOR_TEMPERATURE = 1 << 8,
+  STATE_RUNTIME = 1 << 9,
+  // Status
+  STATE_OPERATING = 1 << 10,
+  STATE_COMPRESSOR_FREQUENCY = 1 << 11,
+  STATE_INPUT_WATTS = 1 << 12,
+  STATE_LIFETIME_KWH = 1 << 13,
+  // Run state
+  STATE_DEFROST = 1 << 14,
+  STATE_FILTER = 1 << 15,
+  STATE_PREHEAT = 1 << 16,
+  STATE_STANDBY = 1 << 17,
+  STATE_ACTUAL_FAN = 1 << 18,
+  // Errors
+  STATE_ERROR = 1 << 19,
+  // Thermostat
+  STATE_THERMOSTAT_HUMIDITY = 1 << 20,
+  STATE_THERMOSTAT_BATTERY = 1 << 21,
+  STATE_THERMOSTAT_TEMPERATURE = 1 << 22,
+  // MITP
+  STATE_USING_INTERNAL_TEMPERATURE = 1 << 23,
+  STATE_PASSTHROUGH_LATENCY = 1 << 24,
+  STATE_PREFERENCE_SAVES = 1 << 25,
+  STATE_STALE = 1 << 26,
+  STATE_CONNECTED = 1 << 27,
+  STATE_RECONNECTS = 1 << 28,
+  STATE_COMMAND_RESULT = 1 << 29,
+};
+
+static const uint8_t STATE_FIELD_COUNT = 30;
+static const uint32_t STATE_FIELDS_NONE = 0;
+static const uint32_t STATE_FIELDS_ALL = (1 << STATE_FIELD_COUNT) - 1;
+
+// Fields the climate entity's state is derived from
+static const uint32_t STATE_FIELDS_CLIMATE = STATE_POWER | STATE_MODE | STATE_TARGET_TEMPERATURE | STATE_FAN |
+                                             STATE_CURRENT_TEMPERATURE | STATE_OPERATING;
+
+/* The last known state of the heat pump and thermostat, as received in packets.  Changes are tracked per field, and
+every change bumps the version, so publishing only needs to look at what's changed since the last publish.*/
+struct HeatpumpState {
+  // Settings
+  bool power = false;
+  uint8_t mode = 0;
+  float target_temperature = NAN;
+  uint8_t fan = 0;
+  uint8_t vane = 0;
+  uint8_t horizontal_vane = 0;
+  bool isee = false;
+  // Temperatures
+  float current_temperature = NAN;
+  float outdoor_temperature = NAN;
+  uint32_t runtime_minutes = 0;
+  // Status
+  bool operating = false;
+  uint8_t compressor_frequency = 0;
+  uint16_t input_watts = 0;
+  float lifetime_kwh = NAN;
+  // Run state
+  bool defrost = false;
+  bool filter = false;
+  bool preheat = false;
+  bool standby = false;
+  uint8_t actual_fan = 0;
+  // Errors
+  uint16_t error_code = 0;
+  uint8_t error_short_code = 0;
+  // Thermostat
+  float thermostat_humidity = NAN;
+  uint8_t thermostat_battery = 0;
+  float thermostat_temperature = NAN;
+  // MITP
+  bool using_internal_temperature = true;
+  float passthrough_latency_ms = NAN;
+  uint32_t preference_saves = 0;
+  bool stale = false;  // Is the climate state restored from the last boot, and not yet received from the heat pump?
+  bool connected = false;
+  uint32_t reconnects = 0;
+  uint8_t command_result = 0;  // CommandResult of the last settings change
+
+  // Sets a field's value, marking it changed if it differs from the current value (or the field was never set)
+  template<typename T> bool update(const StateField field, T &member, const T value) {
+    if ((known_ & field) && (member == value || (is_nan_(member) && is_nan_(value)))) {
+      // Sampled fields are marked changed by every update, even if the value is the same
+      if (sampled_ & field) {
+        touch(field);
+      }
+      return false;
+    }
+    member = value;
+    touch(field);
+    return true;
+  }
+  // Marks fields changed without changing their values (e.g. to publish a repeated value)
+  void touch(const uint32_t fields) {
+    known_ |= fields;
+    changed_ |= fields;
+    version_++;
+  }
+
+  /* Makes the next update of fields count as a change, even if the value is the same.  Used once something other than
+  this state has been published for them (e.g. an optimistic publish of a command), so the received value is always
+  published afterwards, even when it's unchanged (e.g. the command was rejected).*/
+  void forget(const uint32_t fields) { known_ &= ~fields; }
+
+  // Fields whose listeners need to see every update (e.g. to average them), not just changes
+  void set_sampled(const uint32_t fields) { sampled_ |= fields; }
+
+  uint32_t get_changed() const { return changed_; }
+  // Returns the fields changed since the last call, and clears them
+  uint32_t take_changed() {
+    const uint32_t changed = changed_;
+    changed_ = 0;
+    return changed;
+  }
+  uint32_t get_version() const { return version_; }
+  bool is_known(const uint32_t fields) const { return (known_ & fields) == fields; }
+
+ protected:
+  template<typename T> static bool is_nan_(const T value) {
+    if constexpr (std::is_floating_point_v<T>) {
+      return std::isnan(value);
+    } else {
+      return false;
+    }
+  }
+
+  uint32_t known_ = 0;    // Fields that have been set (since they were last forgotten)
+  uint32_t changed_ = 0;  // Fields changed since the last publish
+  uint32_t sampled_ = 0;
+  uint32_t version_ = 0;
+};
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
@@ -5,36 +5,34 @@ namespace mitsubishi_itp {
 
 // Called to instruct a change of the climate controls
 void MitsubishiUART::control(const climate::ClimateCall &call) {
-  SettingsSetRequestPacket set_request_packet = SettingsSetRequestPacket();
-
   // Apply fan settings
   // Prioritize a custom fan mode if it's set.
   if (call.get_custom_fan_mode()) {
     if (call.get_custom_fan_mode() == FAN_MODE_VERYHIGH) {
       set_custom_fan_mode_(FAN_MODE_VERYHIGH);
-      set_request_packet.set_fan(SettingsSetRequestPacket::FAN_4);
+      pending_settings_.fan = SettingsSetRequestPacket::FAN_4;
     }
   } else if (call.get_fan_mode().has_value()) {
     switch (call.get_fan_mode().value()) {
       case climate::CLIMATE_FAN_QUIET:
         set_fan_mode_(climate::CLIMATE_FAN_QUIET);
-        set_request_packet.set_fan(SettingsSetRequestPacket::FAN_QUIET);
+        pending_settings_.fan = SettingsSetRequestPacket::FAN_QUIET;
         break;
       case climate::CLIMATE_FAN_LOW:
         set_fan_mode_(climate::CLIMATE_FAN_LOW);
-        set_request_packet.set_fan(SettingsSetRequestPacket::FAN_1);
+        pending_settings_.fan = SettingsSetRequestPacket::FAN_1;
         break;
       case climate::CLIMATE_FAN_MEDIUM:
         set_fan_mode_(climate::CLIMATE_FAN_MEDIUM);
-        set_request_packet.set_fan(SettingsSetRequestPacket::FAN_2);
+        pending_settings_.fan = SettingsSetRequestPacket::FAN_2;
         break;
       case climate::CLIMATE_FAN_HIGH:
         set_fan_mode_(climate::CLIMATE_FAN_HIGH);
-        set_request_packet.set_fan(SettingsSetRequestPacket::FAN_3);
+        pending_settings_.fan = SettingsSetRequestPacket::FAN_3;
         break;
       case climate::CLIMATE_FAN_AUTO:
         set_fan_mode_(climate::CLIMATE_FAN_AUTO);
-        set_request_packet.set_fan(SettingsSetRequestPacket::FAN_AUTO);
+        pending_settings_.fan = SettingsSetRequestPacket::FAN_AUTO;
         break;
       default:
         ESP_LOGW(TAG, "Unhandled fan mode %i!", call.get_fan_mode().value());
@@ -49,23 +47,28 @@ void MitsubishiUART::control(const climate::ClimateCall &call) {
 
     switch (call.get_mode().value()) {
       case climate::CLIMATE_MODE_HEAT_COOL:
-        set_request_packet.set_power(true).set_mode(SettingsSetRequestPacket::MODE_BYTE_AUTO);
+        pending_settings_.power = true;
+        pending_settings_.mode = SettingsSetRequestPacket::MODE_BYTE_AUTO;
         break;
       case climate::CLIMATE_MODE_COOL:
-        set_request_packet.set_power(true).set_mode(SettingsSetRequestPacket::MODE_BYTE_COOL);
+        pending_settings_.power = true;
+        pending_settings_.mode = SettingsSetRequestPacket::MODE_BYTE_COOL;
         break;
       case climate::CLIMATE_MODE_HEAT:
-        set_request_packet.set_power(true).set_mode(SettingsSetRequestPacket::MODE_BYTE_HEAT);
+        pending_settings_.power = true;
+        pending_settings_.mode = SettingsSetRequestPacket::MODE_BYTE_HEAT;
         break;
       case climate::CLIMATE_MODE_FAN_ONLY:
-        set_request_packet.set_power(true).set_mode(SettingsSetRequestPacket::MODE_BYTE_FAN);
+        pending_settings_.power = true;
+        pending_settings_.mode = SettingsSetRequestPacket::MODE_BYTE_FAN;
         break;
       case climate::CLIMATE_MODE_DRY:
-        set_request_packet.set_power(true).set_mode(SettingsSetRequestPacket::MODE_BYTE_DRY);
+        pending_settings_.power = true;
+        pending_settings_.mode = SettingsSetRequestPacket::MODE_BYTE_DRY;
         break;
       case climate::CLIMATE_MODE_OFF:
       default:
-        set_request_packet.set_power(false);
+        pending_settings_.power = false;
         break;
     }
   }
@@ -74,14 +77,14 @@ void MitsubishiUART::control(const climate::ClimateCall &call) {
 
   if (call.get_target_temperature().has_value()) {
     target_temperature = call.get_target_temperature().value();
-    set_request_packet.set_target_temperature(call.get_target_temperature().value());
+    pending_settings_.target_temperature = call.get_target_temperature().value();
   } else if (call.get_mode().has_value()) {
     // If we didn't get a new target temp, but we did get a mode, use the last known target temp:
     auto previous_target = mode_recall_setpoints_[call.get_mode().value()];
     if (previous_target > 0.0f) {
       ESP_LOGD(TAG, "Loading previous target temp %f", previous_target);
       target_temperature = previous_target;
-      set_request_packet.set_target_temperature(previous_target);
+      pending_settings_.target_temperature = previous_target;
     }
   }
 
@@ -114,13 +117,180 @@ void MitsubishiUART::control(const climate::ClimateCall &call) {
   // HVane?
   // Swing?
 
-  // We're assuming that every climate call *does* make some change worth sending to the heat pump
-  // Queue the packet to be sent first (so any subsequent update packets come *after* our changes)
-  hp_bridge_.send_packet(set_request_packet);
+  // Changes are merged with any other recent changes, and only sent if they differ from the heat pump's state
+  schedule_settings_flush_();
 
   // Publish state and any sensor changes (shouldn't be any a result of this function, but
   // since they lazy-publish, no harm in trying)
   do_publish_();
+  // That published what was asked for, make sure what the heat pump actually does is published too
+  state_.forget(STATE_FIELDS_CLIMATE);
+}
+
+// Sends pending settings changes after the debounce window, so a burst of changes becomes one packet
+void MitsubishiUART::schedule_settings_flush_() {
+  if (settings_debounce_ms_ == 0) {
+    flush_settings_();
+    return;
+  }
+
+  if (!settings_flush_scheduled_) {
+    settings_flush_scheduled_ = true;
+    set_timeout("settings_flush", settings_debounce_ms_, [this]() { flush_settings_(); });
+  }
+}
+
+// If pending has a value that differs from known, updates known and returns true.  Clears pending either way.
+template<typename T> static bool take_settings_change(optional<T> &pending, optional<T> &known) {
+  if (!pending.has_value()) {
+    return false;
+  }
+
+  const bool changed = !known.has_value() || known.value() != pending.value();
+  known = pending;
+  pending.reset();
+  return changed;
+}
+
+void MitsubishiUART::flush_settings_() {
+  settings_flush_scheduled_ = false;
+
+  SettingsSetRequestPacket set_request_packet = SettingsSetRequestPacket();
+  HeatpumpSettings commanded;  // Only the fields being sent
+  bool changed = false;
+
+  if (take_settings_change(pending_settings_.power, known_settings_.power)) {
+    set_request_packet.set_power(known_settings_.power.value());
+    commanded.power = known_settings_.power;
+    changed = true;
+  }
+  if (take_settings_change(pending_settings_.mode, known_settings_.mode)) {
+    set_request_packet.set_mode(known_settings_.mode.value());
+    commanded.mode = known_settings_.mode;
+    changed = true;
+  }
+  if (take_settings_change(pending_settings_.target_temperature, known_settings_.target_temperature)) {
+    set_request_packet.set_target_temperature(known_settings_.target_temperature.value());
+    commanded.target_temperature = known_settings_.target_temperature;
+    changed = true;
+  }
+  if (take_settings_change(pending_settings_.fan, known_settings_.fan)) {
+    set_request_packet.set_fan(known_settings_.fan.value());
+    commanded.fan = known_settings_.fan;
+    changed = true;
+  }
+  if (take_settings_change(pending_settings_.vane, known_settings_.vane)) {
+    set_request_packet.set_vane(known_settings_.vane.value());
+    commanded.vane = known_settings_.vane;
+    changed = true;
+  }
+  if (take_settings_change(pending_settings_.horizontal_vane, known_settings_.horizontal_vane)) {
+    set_request_packet.set_horizontal_vane(known_settings_.horizontal_vane.value());
+    commanded.horizontal_vane = known_settings_.horizontal_vane;
+    changed = true;
+  }
+
+  if (!changed) {
+    ESP_LOGD(TAG, "Settings already match the heat pump, nothing sent.");
+    return;
+  }
+
+  // Queue the packet to be sent first (so any subsequent update packets come *after* our changes)
+  const uint32_t generation = ++settings_generation_;
+  if (!hp_bridge_.send_request<SetResponsePacket>(
+          set_request_packet, PacketPriority::COMMAND,
+          [this, generation](const RequestStatus status, const SetResponsePacket *response) {
+            this->handle_settings_set_response_(generation, status, response);
+          })) {
+    ESP_LOGW(TAG, "Settings change could not be queued and was not sent.");
+    // We no longer know what the heat pump's settings are, so don't suppress any changes until they're received again
+    known_settings_ = HeatpumpSettings();
+    return;
+  }
+  commanded_settings_ = commanded;
+  settings_confirming_ = true;
+  response_cache_.invalidate(GetCommand::SETTINGS);
+
+  // Poll faster for a bit so the result of the change is picked up quickly
+  poll_scheduler_.boost(millis());
+}
+
+// The state fields that show the given settings (power also decides the climate's mode)
+static uint32_t commanded_state_fields(const HeatpumpSettings &settings) {
+  uint32_t fields = STATE_FIELDS_NONE;
+  if (settings.power.has_value()) {
+    fields |= STATE_POWER | STATE_MODE;
+  }
+  if (settings.mode.has_value()) {
+    fields |= STATE_MODE;
+  }
+  if (settings.target_temperature.has_value()) {
+    fields |= STATE_TARGET_TEMPERATURE;
+  }
+  if (settings.fan.has_value()) {
+    fields |= STATE_FAN;
+  }
+  if (settings.vane.has_value()) {
+    fields |= STATE_VANE;
+  }
+  if (settings.horizontal_vane.has_value()) {
+    fields |= STATE_HORIZONTAL_VANE;
+  }
+  return fields;
+}
+
+/* Read-after-write: once the heat pump has responded to a settings change, its settings are read back straight away
+(rather than waiting for the next poll), and compared with what was sent.  Heat pumps can quietly adjust a change (e.g.
+clamp the setpoint to what the mode allows), so a successful response alone doesn't mean the change was applied.
+
+Only the latest change is confirmed, results for earlier ones are ignored once another has been sent.*/
+void MitsubishiUART::handle_settings_set_response_(const uint32_t generation, const RequestStatus status,
+                                                   const SetResponsePacket *response) {
+  if (generation != settings_generation_) {
+    return;
+  }
+  if (response == nullptr) {
+    settings_unanswered_();
+    return;
+  }
+
+  const bool rejected = !response->is_successful();
+  // Whatever the read back settings say about the commanded fields is published, even if it's what was last published
+  state_.forget(commanded_state_fields(commanded_settings_));
+  hp_bridge_.send_request<SettingsGetResponsePacket>(
+      GET_SETTINGS_FRAME, PacketPriority::COMMAND,
+      [this, generation, rejected](const RequestStatus status, const SettingsGetResponsePacket *settings) {
+        if (generation != this->settings_generation_) {
+          return;
+        }
+        if (settings == nullptr) {
+          this->settings_unanswered_();
+          return;
+        }
+        this->confirm_settings_(*settings, rejected);
+      });
+}
+
+void MitsubishiUART::settings_unanswered_() {
+  settings_confirming_ = false;
+  ESP_LOGW(TAG, "Settings change was not answered by the heat pump.");
+  // We no longer know what the heat pump's settings are, so don't suppress any changes until they're received again
+  known_settings_ = HeatpumpSettings();
+  alert_listeners_command_result_(CommandResult::UNANSWERED);
+}
+
+// Called once the read back settings have been processed (and so published) as usual
+void MitsubishiUART::confirm_settings_(const SettingsGetResponsePacket &packet, const bool rejected) {
+  settings_confirming_ = false;
+  CommandResult result = CommandResult::ACCEPTED;
+  if (rejected) {
+    result = CommandResult::REJECTED;
+  } else if (!commanded_settings_.matches(packet)) {
+    result = CommandResult::ADJUSTED;
+  }
+
+  ESP_LOGD(TAG, "Settings change %s.", COMMAND_RESULT_NAMES[static_cast<uint8_t>(result)]);
+  alert_listeners_command_result_(result);
 }
 
 }  // namespace mitsubishi_itp
@@ -6,15 +6,55 @@ namespace mitsubishi_itp {
 void MitsubishiUART::route_packet_(const Packet &packet) {
   // If the packet is associated with the thermostat and just came from the thermostat, send it to the heatpump
   // If it came from the heatpump, send it back to the thermostat
+  // (Packets that were already forwarded by cut-through have no source bridge, so aren't routed again)
   if (packet.get_controller_association() == ControllerAssociation::THERMOSTAT) {
     if (packet.get_source_bridge() == SourceBridge::THERMOSTAT) {
-      hp_bridge_.send_packet(packet);
+      hp_bridge_.forward_packet(packet, ts_bridge_->get_rx_micros());
     } else if (packet.get_source_bridge() == SourceBridge::HEATPUMP) {
-      ts_bridge_->send_packet(packet);
+      ts_bridge_->forward_packet(packet, hp_bridge_.get_rx_micros());
     }
   }
 }
 
+/* Returns true if a raw packet would only be routed by the handlers below (and not intercepted), so it can be
+forwarded by cut-through before it's decoded.  This needs to be kept in sync with the handlers.*/
+bool MitsubishiUART::is_passthrough_only_(const RawPacket &pkt) const {
+  if (pkt.get_controller_association() != ControllerAssociation::THERMOSTAT) {
+    return false;
+  }
+
+  // Everything coming back from the heat pump for the thermostat is routed
+  if (pkt.get_source_bridge() == SourceBridge::HEATPUMP) {
+    return true;
+  }
+
+  switch (static_cast<PacketType>(pkt.get_packet_type())) {
+    case PacketType::GET_REQUEST:
+      switch (static_cast<GetCommand>(pkt.get_command())) {
+        case GetCommand::THERMOSTAT_STATE_DOWNLOAD:
+        case GetCommand::THERMOSTAT_GET_AB:
+          return !enhanced_mhk_support_;
+        default:
+          // Requests the proxy can answer are intercepted, misses are forwarded as usual
+          return !thermostat_proxy_ || !response_cache_.is_fresh(pkt.get_command(), millis());
+      }
+    case PacketType::SET_REQUEST:
+      switch (static_cast<SetCommand>(pkt.get_command())) {
+        case SetCommand::REMOTE_TEMPERATURE:
+          return false;
+        case SetCommand::THERMOSTAT_SENSOR_STATUS:
+        case SetCommand::THERMOSTAT_HELLO:
+        case SetCommand::THERMOSTAT_STATE_UPLOAD:
+        case SetCommand::THERMOSTAT_SET_AA:
+          return !enhanced_mhk_support_;
+        default:
+          return true;
+      }
+    default:
+      return true;
+  }
+}
+
 // Packet Handlers
 void MitsubishiUART::process_packet(const Packet &packet) {
   ESP_LOGI(TAG, "Generic unhandled packet type %x received.", packet.get_packet_type());
@@ -32,8 +72,13 @@ void MitsubishiUART::process_packet(const ConnectResponsePacket &packet) {
   ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
   route_packet_(packet);
   // Not sure if there's any needed content in this response, so assume we're connected.
-  hp_connected_ = true;
-  ESP_LOGI(TAG, "Heatpump connected.");
+  set_connected_(true);
+
+  // Identify the heat pump straight away (rather than on the next update)
+  if (!capabilities_requested_) {
+    hp_bridge_.send_packet(CAPABILITIES_REQUEST_FRAME);
+    capabilities_requested_ = true;
+  }
 }
 
 void MitsubishiUART::process_packet(const CapabilitiesRequestPacket &packet) {
@@ -47,9 +92,21 @@ void MitsubishiUART::process_packet(const CapabilitiesResponsePacket &packet) {
   route_packet_(packet);
   // Not sure if there's any needed content in this response, so assume we're connected.
   // TODO: Is there more useful info in these?
-  hp_connected_ = true;
+  set_connected_(true);
   capabilities_cache_ = packet;
   ESP_LOGI(TAG, "Received heat pump identification packet.");
+
+  WarmStartCache warm_start = warm_start_.get();
+  if (warm_start.capabilities.has_value() && !warm_start.capabilities.matches(packet)) {
+    // A different heat pump (or its firmware changed), so nothing else that was learned about the last one holds
+    ESP_LOGI(TAG, "Heat pump identification changed, discarding what was learned about the last one.");
+    warm_start = WarmStartCache();
+    poll_scheduler_.clear_unsupported();
+  }
+  warm_start.capabilities.assign(packet);
+  if (warm_start_.set(warm_start)) {
+    schedule_preferences_commit();
+  }
 }
 
 void MitsubishiUART::process_packet(const GetRequestPacket &packet) {
@@ -63,15 +120,122 @@ void MitsubishiUART::process_packet(const GetRequestPacket &packet) {
       this->handle_thermostat_ab_get_request(packet);
       break;
     default:
-      route_packet_(packet);
+      if (!answer_from_cache_(packet)) {
+        route_packet_(packet);
+      }
+  }
+}
+
+/* Thermostat proxy: the thermostat polls the heat pump for much the same things we do, so rather than forwarding each
+of its GET requests (doubling the traffic on the heat pump's line, and making the thermostat wait behind our queue),
+they're answered with the heat pump's last response if it's fresh enough.  Returns false if the request needs to be
+forwarded instead.*/
+bool MitsubishiUART::answer_from_cache_(const GetRequestPacket &packet) {
+  if (!thermostat_proxy_ || !ts_bridge_ || packet.get_controller_association() != ControllerAssociation::THERMOSTAT) {
+    return false;
+  }
+
+  uint8_t bytes[PACKET_MAX_SIZE];
+  uint8_t length = 0;
+  if (!response_cache_.lookup(static_cast<uint8_t>(packet.get_requested_command()), millis(), bytes, length)) {
+    ESP_LOGV(TAG, "Thermostat proxy miss for %x, forwarding.", static_cast<uint8_t>(packet.get_requested_command()));
+    return false;
+  }
+
+  ESP_LOGV(TAG, "Thermostat proxy hit for %x.", static_cast<uint8_t>(packet.get_requested_command()));
+  // Timed from the thermostat's request, like any other pass-through packet
+  ts_bridge_->forward_packet(Packet(RawPacket(bytes, length, SourceBridge::NONE, ControllerAssociation::THERMOSTAT)),
+                             ts_bridge_->get_rx_micros());
+  return true;
+}
+
+// Responses are cached whoever asked for them (our polls or the thermostat)
+void MitsubishiUART::cache_response_(const Packet &packet) {
+  if (thermostat_proxy_) {
+    // raw_packet() isn't const, but it's only read from here
+    response_cache_.store(const_cast<Packet &>(packet).raw_packet(), millis());
   }
 }
 
 void MitsubishiUART::process_packet(const SettingsGetResponsePacket &packet) {
   ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
   route_packet_(packet);
+  cache_response_(packet);
   alert_listeners_packet_(packet);
+  poll_scheduler_.mark_answered(GetCommand::SETTINGS);
+  poll_scheduler_.set_powered(packet.get_power());
+
+  state_.update(STATE_POWER, state_.power, packet.get_power());
+  state_.update(STATE_MODE, state_.mode, packet.get_mode());
+  state_.update(STATE_TARGET_TEMPERATURE, state_.target_temperature, packet.get_target_temp());
+  state_.update(STATE_FAN, state_.fan, packet.get_fan());
+  state_.update(STATE_VANE, state_.vane, packet.get_vane());
+  state_.update(STATE_HORIZONTAL_VANE, state_.horizontal_vane, packet.get_horizontal_vane());
+  state_.update(STATE_ISEE, state_.isee, packet.is_i_see_enabled());
+  state_.update(STATE_STALE, state_.stale, false);
+
+  WarmStartCache warm_start = warm_start_.get();
+  warm_start.settings.assign(packet);
+  if (warm_start_.set(warm_start)) {
+    schedule_preferences_commit();
+  }
+
+  /* Keep track of the actual settings so unchanged fields aren't sent.  If they've been changed by something else (e.g.
+  an IR remote), they may change again between polls, so changes aren't suppressed until the next read confirms them.*/
+  if (!settings_confirming_ && !known_settings_.matches(packet)) {
+    ESP_LOGD(TAG, "Settings were changed by another controller.");
+    known_settings_ = HeatpumpSettings();
+  } else {
+    known_settings_.power = packet.get_power();
+    known_settings_.mode = to_set_mode_byte(packet.get_mode());
+    known_settings_.target_temperature = packet.get_target_temp();
+    known_settings_.fan = static_cast<SettingsSetRequestPacket::FanByte>(packet.get_fan());
+    known_settings_.vane = static_cast<SettingsSetRequestPacket::VaneByte>(packet.get_vane());
+    known_settings_.horizontal_vane =
+        static_cast<SettingsSetRequestPacket::HorizontalVaneByte>(packet.get_horizontal_vane());
+  }
+
+  const bool climate_changed = apply_climate_settings_(packet);
+
+  if (mode <= MAX_RECALL_MODE_INDEX) {
+    mode_recall_setpoints_[mode] = target_temperature;
+    save_preferences_();
+  }
+
+  switch (mode) {
+    case climate::CLIMATE_MODE_COOL:
+    case climate::CLIMATE_MODE_DRY:
+      this->mhk_state_.cool_setpoint_ = target_temperature;
+      break;
+    case climate::CLIMATE_MODE_HEAT:
+      this->mhk_state_.heat_setpoint_ = target_temperature;
+      break;
+    case climate::CLIMATE_MODE_HEAT_COOL:
+      this->mhk_state_.cool_setpoint_ = target_temperature + 2;
+      this->mhk_state_.heat_setpoint_ = target_temperature - 2;
+    default:
+      break;
+  }
+
+  // Something changed the settings, poll faster for a bit to pick up the effects
+  if (climate_changed) {
+    poll_scheduler_.boost(millis());
+  }
+}
+
+bool HeatpumpSettings::matches(const SettingsGetResponsePacket &packet) const {
+  return (!power.has_value() || power.value() == packet.get_power()) &&
+         (!mode.has_value() || mode.value() == to_set_mode_byte(packet.get_mode())) &&
+         (!target_temperature.has_value() ||
+          lroundf(target_temperature.value() * 2) == lroundf(packet.get_target_temp() * 2)) &&
+         (!fan.has_value() || fan.value() == packet.get_fan()) &&
+         (!vane.has_value() || vane.value() == packet.get_vane()) &&
+         (!horizontal_vane.has_value() || horizontal_vane.value() == packet.get_horizontal_vane());
+}
 
+/* Sets the climate's mode, target temperature and fan from settings.  Used for settings received from the heat pump,
+and for the last settings received before a restart (see restore_warm_start_()).*/
+bool MitsubishiUART::apply_climate_settings_(const SettingsGetResponsePacket &packet) {
   // Mode
 
   const climate::ClimateMode old_mode = mode;
@@ -105,33 +269,12 @@ void MitsubishiUART::process_packet(const SettingsGetResponsePacket &packet) {
     mode = climate::CLIMATE_MODE_OFF;
   }
 
-  publish_on_update_ |= (old_mode != mode);
-
   // Temperature
   const float old_target_temperature = target_temperature;
   target_temperature = packet.get_target_temp();
-  publish_on_update_ |= (old_target_temperature != target_temperature);
-  if (mode <= MAX_RECALL_MODE_INDEX) {
-    mode_recall_setpoints_[mode] = target_temperature;
-  }
-
-  switch (mode) {
-    case climate::CLIMATE_MODE_COOL:
-    case climate::CLIMATE_MODE_DRY:
-      this->mhk_state_.cool_setpoint_ = target_temperature;
-      break;
-    case climate::CLIMATE_MODE_HEAT:
-      this->mhk_state_.heat_setpoint_ = target_temperature;
-      break;
-    case climate::CLIMATE_MODE_HEAT_COOL:
-      this->mhk_state_.cool_setpoint_ = target_temperature + 2;
-      this->mhk_state_.heat_setpoint_ = target_temperature - 2;
-    default:
-      break;
-  }
 
   // Fan
-  static bool fan_changed = false;
+  bool fan_changed = false;
   switch (packet.get_fan()) {
     case 0x00:
       fan_changed = set_fan_mode_(climate::CLIMATE_FAN_AUTO);
@@ -153,26 +296,35 @@ void MitsubishiUART::process_packet(const SettingsGetResponsePacket &packet) {
       break;
   }
 
-  publish_on_update_ |= fan_changed;
+  return old_mode != mode || old_target_temperature != target_temperature || fan_changed;
 }
 
 void MitsubishiUART::process_packet(const CurrentTempGetResponsePacket &packet) {
   ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
   route_packet_(packet);
+  cache_response_(packet);
   alert_listeners_packet_(packet);
+  poll_scheduler_.mark_answered(GetCommand::CURRENT_TEMP);
+
+  state_.update(STATE_CURRENT_TEMPERATURE, state_.current_temperature, packet.get_current_temp());
+  state_.update(STATE_OUTDOOR_TEMPERATURE, state_.outdoor_temperature, packet.get_outdoor_temp());
+  state_.update(STATE_RUNTIME, state_.runtime_minutes, packet.get_runtime_minutes());
+
   // This will be the same as the remote temperature if we're using a remote sensor, otherwise the internal temp
-  const float old_current_temperature = current_temperature;
   current_temperature = packet.get_current_temp();
-
-  publish_on_update_ |= (old_current_temperature != current_temperature);
 }
 
 void MitsubishiUART::process_packet(const StatusGetResponsePacket &packet) {
   ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
   route_packet_(packet);
+  cache_response_(packet);
   alert_listeners_packet_(packet);
+  poll_scheduler_.mark_answered(GetCommand::STATUS);
 
-  const climate::ClimateAction old_action = action;
+  state_.update(STATE_OPERATING, state_.operating, packet.get_operating());
+  state_.update(STATE_COMPRESSOR_FREQUENCY, state_.compressor_frequency, packet.get_compressor_frequency());
+  state_.update(STATE_INPUT_WATTS, state_.input_watts, packet.get_input_watts());
+  state_.update(STATE_LIFETIME_KWH, state_.lifetime_kwh, packet.get_lifetime_kwh());
 
   // If mode is off, action is off
   if (mode == climate::CLIMATE_MODE_OFF) {
@@ -216,15 +368,19 @@ void MitsubishiUART::process_packet(const StatusGetResponsePacket &packet) {
   else {
     action = climate::CLIMATE_ACTION_IDLE;
   }
-
-  publish_on_update_ |= (old_action != action);
 }
 void MitsubishiUART::process_packet(const RunStateGetResponsePacket &packet) {
   ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
   route_packet_(packet);
+  cache_response_(packet);
   alert_listeners_packet_(packet);
+  poll_scheduler_.mark_answered(GetCommand::RUN_STATE);
 
-  run_state_received_ = true;  // Set this since we received one
+  state_.update(STATE_DEFROST, state_.defrost, packet.in_defrost());
+  state_.update(STATE_FILTER, state_.filter, packet.service_filter());
+  state_.update(STATE_PREHEAT, state_.preheat, packet.in_preheat());
+  state_.update(STATE_STANDBY, state_.standby, packet.in_standby());
+  state_.update(STATE_ACTUAL_FAN, state_.actual_fan, packet.get_actual_fan_speed());
 
   // TODO: Not sure what AutoMode does yet
 }
@@ -233,6 +389,11 @@ void MitsubishiUART::process_packet(const ErrorStateGetResponsePacket &packet) {
   ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
   route_packet_(packet);
   alert_listeners_packet_(packet);
+  poll_scheduler_.mark_answered(GetCommand::ERROR_INFO);
+
+  // Either code changing changes the reported error
+  state_.update(STATE_ERROR, state_.error_code, packet.get_error_code());
+  state_.update(STATE_ERROR, state_.error_short_code, packet.get_raw_short_code());
 }
 
 void MitsubishiUART::process_packet(const Functions1GetResponsePacket &packet) {
@@ -251,6 +412,9 @@ void MitsubishiUART::process_packet(const SettingsSetRequestPacket &packet) {
   // forward this packet as-is; we're just intercepting to log.
   route_packet_(packet);
   alert_listeners_packet_(packet);
+  response_cache_.invalidate(GetCommand::SETTINGS);
+  // The thermostat is changing the settings, so what we last read can't be used to suppress changes
+  known_settings_ = HeatpumpSettings();
 }
 
 void MitsubishiUART::process_packet(const RemoteTemperatureSetRequestPacket &packet) {
@@ -259,10 +423,16 @@ void MitsubishiUART::process_packet(const RemoteTemperatureSetRequestPacket &pac
   ts_bridge_->send_packet(SetResponsePacket());  // Immediately respond to thermostat (to keep it happy)
   alert_listeners_packet_(packet);               // Alert sensors of new temperature
 
+  if (!packet.get_use_internal_temperature()) {
+    // Every report is published (even if it's the same), to show how often the thermostat is reporting
+    state_.thermostat_temperature = packet.get_remote_temperature();
+    state_.touch(STATE_THERMOSTAT_TEMPERATURE);
+  }
+
   // Report the temperature only if the thermostat isn't requesting internal
   if (!packet.get_use_internal_temperature()) {
     float t = packet.get_remote_temperature();
-    temperature_source_report(TEMPERATURE_SOURCE_THERMOSTAT, t);
+    temperature_source_report(thermostat_temperature_source_, t);
   }
 }
 
@@ -278,6 +448,11 @@ void MitsubishiUART::process_packet(const ThermostatSensorStatusPacket &packet)
 
   alert_listeners_packet_(packet);
 
+  state_.update(STATE_THERMOSTAT_HUMIDITY, state_.thermostat_humidity, packet.get_indoor_humidity_percent());
+  if (packet.get_flags() & 0x08) {
+    state_.update(STATE_THERMOSTAT_BATTERY, state_.thermostat_battery, packet.get_thermostat_battery_state());
+  }
+
   ts_bridge_->send_packet(SetResponsePacket());
 }
 
@@ -22,22 +22,49 @@ MitsubishiUART::MitsubishiUART(uart::UARTComponent *hp_uart_comp)
 // Used to restore state of previous MITP-specific settings (like temperature source or pass-thru mode)
 // Most other climate-state is preserved by the heatpump itself and will be retrieved after connection
 void MitsubishiUART::setup() {
+  if (const char *frame = find_mismatched_constant_frame()) {
+    ESP_LOGE(TAG, "Constant %s frame doesn't match the itp_packet library's packet, requests may not be understood.",
+             frame);
+  }
+
   for (auto *listener : listeners_) {
     listener->setup();
+    // Only known once the listener is configured, so this can't be done at registration
+    state_.set_sampled(listener->get_sampled_fields());
+  }
+  if (listener_table_ != nullptr) {
+    listener_table_->setup();
+    state_.set_sampled(listener_table_->get_sampled_fields());
   }
-  // Using App.get_compilation_time() means these will get reset each time the firmware is updated, but this
-  // is an easy way to prevent wierd conflicts if e.g. select options change.
-  preferences_ = global_preferences->make_preference<MITPPreferences>(get_object_id_hash() ^
-                                                                      fnv1_hash(App.get_compilation_time()));
+  // Keyed by this component (and the preferences' layout) rather than the build, so they survive firmware updates
+  preferences_.init(global_preferences->make_preference<MITPPreferences>(
+      get_object_id_hash() ^ fnv1_hash("mitp_preferences_v" + to_string(PREFERENCES_VERSION))));
+  register_preference(&preferences_);
   restore_preferences_();
+  warm_start_.init(global_preferences->make_preference<WarmStartCache>(
+      get_object_id_hash() ^ fnv1_hash("mitp_warm_start_v" + to_string(PREFERENCES_VERSION))));
+  register_preference(&warm_start_);
+  restore_warm_start_();
+  // Nothing has been saved yet, which is a count rather than unknown
+  alert_listeners_preference_saves_(preference_saves_);
+
+  // Don't wait for the first update to connect
+  send_connect_();
+  alert_listeners_link_state_(false, reconnects_);
 #ifdef USE_TIME
   this->time_source_->add_on_time_sync_callback([this] { this->time_sync_ = true; });
 #endif
+
+  if (ts_bridge_ && passthrough_cut_through_) {
+    auto filter = [this](const RawPacket &pkt) { return this->is_passthrough_only_(pkt); };
+    hp_bridge_.set_cut_through(ts_bridge_.get(), filter);
+    ts_bridge_->set_cut_through(&hp_bridge_, filter);
+  }
 }
 
 void MitsubishiUART::restore_preferences_() {
-  MITPPreferences prefs;
-  if (preferences_.load(&prefs)) {
+  if (preferences_.load()) {
+    const MITPPreferences &prefs = preferences_.get();
     for (auto i = 0; i < MAX_RECALL_MODE_INDEX; i++) {
       if (prefs.modeRecallSetpoints[i] > 0) {
         // If any setpoints are set, assume valid preferences and load all of them
@@ -49,10 +76,59 @@ void MitsubishiUART::restore_preferences_() {
   }
 }
 
+// Picks up where the last boot left off: what the heat pump is, which polls it doesn't answer, and its last settings
+// (published straight away, but marked stale until the heat pump responds)
+void MitsubishiUART::restore_warm_start_() {
+  if (!warm_start_.load()) {
+    return;
+  }
+  const WarmStartCache &warm_start = warm_start_.get();
+
+  if (warm_start.capabilities.has_value()) {
+    capabilities_cache_ = CapabilitiesResponsePacket(warm_start.capabilities.to_raw_packet());
+  }
+  poll_scheduler_.set_unsupported(warm_start.unsupported_polls);
+
+  if (warm_start.settings.has_value()) {
+    apply_climate_settings_(SettingsGetResponsePacket(warm_start.settings.to_raw_packet()));
+    state_.update(STATE_STALE, state_.stale, true);
+    ESP_LOGCONFIG(TAG, "Restored last known settings (stale until the heat pump responds).");
+    do_publish_();
+    schedule_publish_();
+  }
+}
+
+// Only marks the preferences changed (if they have), they're written once they stop changing
 void MitsubishiUART::save_preferences_() {
   MITPPreferences prefs{};
   prefs.modeRecallSetpoints = mode_recall_setpoints_;
-  preferences_.save(&prefs);
+  if (preferences_.set(prefs)) {
+    schedule_preferences_commit();
+  }
+}
+
+// Each change pushes the commit back, so only the last of a burst of changes is written
+void MitsubishiUART::schedule_preferences_commit() {
+  set_timeout("preferences_commit", PREFERENCES_COMMIT_DELAY_MS, [this]() { commit_preferences_(); });
+}
+
+/* Saves the changed preferences.  What's counted is saves handed to ESPHome's preferences, not flash writes: ESPHome
+writes them out on its own schedule (several saves can become one write), and skips data that's already in flash.*/
+void MitsubishiUART::commit_preferences_() {
+  cancel_timeout("preferences_commit");
+
+  const uint32_t saves = preference_saves_;
+  for (auto *preference : registered_preferences_) {
+    if (preference->commit()) {
+      preference_saves_++;
+    }
+  }
+
+  if (preference_saves_ != saves) {
+    ESP_LOGD(TAG, "Saved %lu preference(s), %lu since boot.", (unsigned long) (preference_saves_ - saves),
+             (unsigned long) preference_saves_);
+    alert_listeners_preference_saves_(preference_saves_);
+  }
 }
 
 /* Used for receiving and acting on incoming packets as soon as they're available.
@@ -65,30 +141,69 @@ void MitsubishiUART::loop() {
   if (ts_bridge_)
     ts_bridge_->loop();
 
-  // If we're not on timeout and not on Internal
-  if (!temperature_source_timeout_ && selected_temperature_source_ != TEMPERATURE_SOURCE_INTERNAL) {
-    // if it's been too long since we got a report for our current selected source
-    if (millis() - temperature_reports_[selected_temperature_source_].timestamp > temperature_source_timout_ms_) {
-      // Alert user and set heatpump to internal
-      ESP_LOGW(TAG, "No temperature received from %s for %lu milliseconds, reverting to Internal source",
-               selected_temperature_source_.c_str(), (unsigned long) temperature_source_timout_ms_);
-      // Let listeners know we've changed to the Internal temperature source (but do not change
-      // selected_temperature_source)
-      alert_listeners_internal_temp_(true);
-      temperature_source_timeout_ = true;
-      // Send a packet to the heat pump to tell it to switch to internal temperature sensing
-      hp_bridge_.send_packet(RemoteTemperatureSetRequestPacket().set_use_internal_temperature(true));
-    } else if (temperature_source_echo_ms_ > 0 &&
-               millis() - temperature_source_echo_last_timestamp_ > temperature_source_echo_ms_) {
-      // If we haven't timed out, and an echo is set, check and send the last temperature for the selected source
-      if (!isnan(temperature_reports_[selected_temperature_source_].temperature)) {
-        ESP_LOGD(TAG, "Echoing last received temperature");
-        hp_bridge_.send_packet(RemoteTemperatureSetRequestPacket().set_remote_temperature(
-            temperature_reports_[selected_temperature_source_].temperature));
-        temperature_source_echo_last_timestamp_ = millis();
+  // Request any updates that are due from the heatpump
+  if (hp_connected_) {
+    const uint32_t now = millis();
+    check_link_(now);
+    if (hp_connected_) {
+      poll_scheduler_.poll(hp_bridge_, now);
+    }
+  }
+}
+
+/* Once the heat pump stops answering (e.g. it was power cycled, or its cable was reseated), everything waiting on it
+is dropped and connect requests are sent instead, backing off until it answers.  Once it does, it's polled for
+everything again straight away.*/
+void MitsubishiUART::check_link_(const uint32_t now) {
+  if (hp_bridge_.get_consecutive_timeouts() >= link_max_timeouts_) {
+    ESP_LOGW(TAG, "Heatpump didn't answer %u requests in a row, reconnecting.", hp_bridge_.get_consecutive_timeouts());
+    set_connected_(false);
+  } else if (link_silence_timeout_ms_ > 0 && now - hp_bridge_.get_last_rx_millis() > link_silence_timeout_ms_) {
+    ESP_LOGW(TAG, "Nothing received from heatpump for %lu ms, reconnecting.",
+             (unsigned long) (now - hp_bridge_.get_last_rx_millis()));
+    set_connected_(false);
+  }
+}
+
+void MitsubishiUART::set_connected_(const bool connected) {
+  if (connected == hp_connected_) {
+    return;
+  }
+  hp_connected_ = connected;
+
+  if (connected) {
+    ESP_LOGI(TAG, "Heatpump connected.");
+    cancel_timeout("reconnect");
+    reconnect_interval_ms_ = reconnect_min_interval_ms_;
+    poll_scheduler_.restart();
+
+    // The heat pump may have restarted, and gone back to its own sensor
+    last_remote_temperature_ = REMOTE_TEMPERATURE_NONE;
+    if (selected_temperature_source_ != TEMPERATURE_SOURCE_INTERNAL_ID && !temperature_source_timeout_) {
+      const TemperatureReport &report = temperature_reports_[selected_temperature_source_];
+      if (!isnan(report.temperature)) {
+        send_remote_temperature_(report.temperature, true);
       }
     }
+  } else {
+    reconnects_++;
+    hp_bridge_.reset();
+    // Identify the heat pump again once it's back, in case it isn't the same one
+    capabilities_requested_ = false;
+    response_cache_.clear();
+    // What's published is only the last known state until the heat pump responds again
+    state_.update(STATE_STALE, state_.stale, true);
+    send_connect_();
   }
+
+  alert_listeners_link_state_(connected, reconnects_);
+}
+
+// Sends a connect request, and schedules the next (a little later each time) in case this one isn't answered
+void MitsubishiUART::send_connect_() {
+  hp_bridge_.send_packet(CONNECT_REQUEST_FRAME);
+  set_timeout("reconnect", reconnect_interval_ms_, [this]() { this->send_connect_(); });
+  reconnect_interval_ms_ = std::min(reconnect_interval_ms_ * 2, reconnect_max_interval_ms_);
 }
 
 void MitsubishiUART::dump_config() {
@@ -99,6 +214,14 @@ void MitsubishiUART::dump_config() {
   if (enhanced_mhk_support_) {
     ESP_LOGCONFIG(TAG, "MHK Enhanced Protocol Mode is ENABLED! This is currently *experimental* and things may break!");
   }
+
+  if (ts_bridge_ && passthrough_cut_through_) {
+    ESP_LOGCONFIG(TAG, "Pass-through cut-through forwarding is enabled.");
+  }
+
+  if (ts_bridge_ && thermostat_proxy_) {
+    ESP_LOGCONFIG(TAG, "Thermostat proxy is enabled, thermostat polls are answered from cached responses.");
+  }
 }
 
 // Set thermostat UART component
@@ -108,212 +231,305 @@ void MitsubishiUART::set_thermostat_uart(uart::UARTComponent *uart) {
   ts_bridge_ = make_unique<ThermostatBridge>(ts_uart_, static_cast<PacketProcessor *>(this));
 }
 
-/* Called periodically as PollingComponent; used to send packets to connect or request updates.
-
-Possible TODO: If we only publish during updates, since data is received during loop, updates will always
-be about `update_interval` late from their actual time.  Generally the update interval should be low enough
-(default is 5seconds) this won't pose a practical problem.
+/* Called periodically as PollingComponent.  Requests for updates are sent from loop() as they come due (see
+PollScheduler), connect requests are scheduled by send_connect_(), and changes are published as they're received (see
+schedule_publish_()).
 */
 void MitsubishiUART::update() {
-  // TODO: Temporarily wait 5 seconds on startup to help with viewing logs
-  if (millis() < 5000) {
+  // Connect requests are sent by send_connect_() until connected
+  if (!hp_connected_) {
     return;
   }
 
-  // If we're not yet connected, send off a connection request (we'll check again next update)
-  if (!hp_connected_) {
-    hp_bridge_.send_packet(ConnectRequestPacket::instance());
-    return;
+  // Remember any polls found to be unsupported, so they aren't rediscovered next boot
+  if (poll_scheduler_.get_unsupported() != warm_start_.get().unsupported_polls) {
+    WarmStartCache warm_start = warm_start_.get();
+    warm_start.unsupported_polls = poll_scheduler_.get_unsupported();
+    warm_start_.set(warm_start);
+    schedule_preferences_commit();
   }
 
-  // Attempt to read capabilities on the next loop after connect.
-  // TODO: This should likely be done immediately after connect, and will likely need to block setup for proper
-  // autoconf.
-  //       For now, just requesting it as part of our "init loops" is a good first step.
-  if (!this->capabilities_requested_) {
-    hp_bridge_.send_packet(CapabilitiesRequestPacket::instance());
-    this->capabilities_requested_ = true;
+  // Report how long pass-through packets took to forward since the last update
+  if (ts_bridge_) {
+    uint32_t forward_latency_total_micros = 0;
+    uint32_t forward_latency_count = 0;
+    hp_bridge_.take_forward_latency(forward_latency_total_micros, forward_latency_count);
+    ts_bridge_->take_forward_latency(forward_latency_total_micros, forward_latency_count);
+    if (forward_latency_count > 0) {
+      alert_listeners_passthrough_latency_(forward_latency_total_micros / 1000.0f / forward_latency_count);
+    }
   }
+}
 
-  // Before requesting additional updates, publish any changes waiting from packets received
+void MitsubishiUART::register_listener(MITPListener *listener) {
+  listeners_.push_back(listener);
 
-  // Notify all listeners a publish is happening, they will decide if actual publish is needed.
-  for (auto *listener : listeners_) {
-    listener->publish();
+  const uint32_t fields = listener->get_state_fields();
+  for (uint8_t field = 0; field < STATE_FIELD_COUNT; field++) {
+    if (fields & (1 << field)) {
+      field_listeners_[field].push_back(listener);
+    }
   }
 
-  if (publish_on_update_) {
-    do_publish_();
-
-    publish_on_update_ = false;
+  const uint32_t subscriptions = listener->get_subscriptions();
+  for (uint8_t event = 0; event < LISTENER_EVENT_COUNT; event++) {
+    if (subscriptions & listener_event_bit(static_cast<ListenerEvent>(event))) {
+      event_listeners_[event].push_back(listener);
+    }
   }
+}
 
-  // Request an update from the heatpump
-  // TODO: This isn't a problem *yet*, but sending all these packets every loop might start to cause some issues
-  // in
-  //       certain configurations or setups. We may want to consider only asking for certain packets on a rarer
-  //       cadence, depending on their utility (e.g. we dont need to check for errors every loop).
-  hp_bridge_.send_packet(
-      GetRequestPacket::get_settings_instance());  // Needs to be done before status packet for mode logic to work
-  if (in_discovery_ || run_state_received_) {
-    hp_bridge_.send_packet(GetRequestPacket::get_runstate_instance());
+/* Publishes changes shortly after they're received, outside of packet processing.  Packets that arrive together (e.g.
+the responses to a round of polls) are likely to be received within the delay, and are published together.*/
+void MitsubishiUART::schedule_publish_() {
+  if (publish_scheduled_) {
+    return;
   }
 
-  hp_bridge_.send_packet(GetRequestPacket::get_status_instance());
-  hp_bridge_.send_packet(GetRequestPacket::get_current_temp_instance());
-  hp_bridge_.send_packet(GetRequestPacket::get_error_info_instance());
+  publish_scheduled_ = true;
+  set_timeout("publish", PUBLISH_DELAY_MS, [this]() {
+    publish_scheduled_ = false;
+    publish_changes_();
+  });
+}
 
-  if (in_discovery_) {
-    // After criteria met, exit discovery mode
-    // Currently this is either 5 updates or a successful RunState response.
-    if (discovery_updates_++ > 5 || run_state_received_) {
-      ESP_LOGD(TAG, "Discovery complete.");
-      in_discovery_ = false;
+/* Only the listeners bound to fields that changed since the last publish are asked to publish (once each, even if
+several of their fields changed).*/
+void MitsubishiUART::publish_changes_() {
+  const uint32_t version = state_.get_version();
+  const uint32_t changed = state_.take_changed();
+  if (changed == 0) {
+    return;
+  }
 
-      if (!run_state_received_) {
-        ESP_LOGI(TAG, "RunState packets not supported.");
+  for (uint8_t field = 0; field < STATE_FIELD_COUNT; field++) {
+    if (!(changed & (1 << field))) {
+      continue;
+    }
+    for (auto *listener : field_listeners_[field]) {
+      if (listener->wake(version)) {
+        listener->publish();
       }
     }
   }
+
+  if (listener_table_ != nullptr) {
+    listener_table_->publish(changed);
+  }
+
+  if (changed & STATE_FIELDS_CLIMATE) {
+    do_publish_();
+  }
 }
 
-void MitsubishiUART::do_publish_() {
-  publish_state();
-  // We can safely do this on every publish as ESPPreferences collects changes and only writes if different
-  save_preferences_();
+void MitsubishiUART::do_publish_() { publish_state(); }
+
+void MitsubishiUART::add_temperature_source(const char *name) {
+  if (temperature_source_count_ >= MAX_TEMPERATURE_SOURCES) {
+    ESP_LOGE(TAG, "Too many temperature sources, %s will be ignored.", name);
+    return;
+  }
+  temperature_reports_[temperature_source_count_++].name = name;
 }
 
-bool MitsubishiUART::select_temperature_source(const std::string &state) {
-  selected_temperature_source_ = state;
+bool MitsubishiUART::select_temperature_source(const uint8_t source) {
+  if (source >= temperature_source_count_) {
+    ESP_LOGW(TAG, "Unknown temperature source %u", source);
+    return false;
+  }
+  selected_temperature_source_ = source;
+  // Deadlines (and any timeout) were for the previous source, the new source gets its own
+  cancel_timeout("temperature_source_timeout");
+  cancel_timeout("temperature_source_echo");
+  temperature_source_timeout_ = false;
+
+  // Whatever the heat pump had came from the previous source
+  last_remote_temperature_ = REMOTE_TEMPERATURE_NONE;
 
   // If we've switched to internal, let the HP know right away
-  if (TEMPERATURE_SOURCE_INTERNAL == state) {
+  if (source == TEMPERATURE_SOURCE_INTERNAL_ID) {
     alert_listeners_internal_temp_(true);
-    hp_bridge_.send_packet(RemoteTemperatureSetRequestPacket().set_use_internal_temperature(true));
+    hp_bridge_.send_packet(RemoteTemperatureSetRequestPacket().set_use_internal_temperature(true),
+                           PacketPriority::REMOTE_TEMPERATURE);
   } else {
+    TemperatureReport &report = temperature_reports_[source];
+    const uint32_t age = millis() - report.timestamp;
     // If we have a fresh temperature already, go ahead and send it immediately.
-    if (millis() - temperature_reports_[selected_temperature_source_].timestamp < temperature_source_timout_ms_ &&
-        !isnan(temperature_reports_[selected_temperature_source_].timestamp)) {
-      hp_bridge_.send_packet(RemoteTemperatureSetRequestPacket().set_remote_temperature(
-          temperature_reports_[selected_temperature_source_].temperature));
+    if (age < temperature_source_timout_ms_ && !isnan(report.temperature)) {
+      send_remote_temperature_(report.temperature, true);
       alert_listeners_internal_temp_(false);
+      // The report is still only good until it would have timed out
+      arm_temperature_source_timeout_(temperature_source_timout_ms_ - age);
     } else {
       // Otherwise, reset that report so it doesn't immediately timeout
-      temperature_reports_[selected_temperature_source_].timestamp = millis();
-      temperature_reports_[selected_temperature_source_].temperature = NAN;
+      report.timestamp = millis();
+      report.temperature = NAN;
+      arm_temperature_source_timeout_(temperature_source_timout_ms_);
     }
   }
 
   return true;
 }
 
-bool MitsubishiUART::select_vane_position(const std::string &state) {
-  SettingsSetRequestPacket::VaneByte position_byte = SettingsSetRequestPacket::VANE_AUTO;
-
-  // NOTE: Annoyed that C++ doesn't have switches for strings, but since this is going to be called
-  // infrequently, this is probably a better solution than over-optimizing via maps or something
-
-  if (state == "Auto") {
-    position_byte = SettingsSetRequestPacket::VANE_AUTO;
-  } else if (state == "1") {
-    position_byte = SettingsSetRequestPacket::VANE_1;
-  } else if (state == "2") {
-    position_byte = SettingsSetRequestPacket::VANE_2;
-  } else if (state == "3") {
-    position_byte = SettingsSetRequestPacket::VANE_3;
-  } else if (state == "4") {
-    position_byte = SettingsSetRequestPacket::VANE_4;
-  } else if (state == "5") {
-    position_byte = SettingsSetRequestPacket::VANE_5;
-  } else if (state == "Swing") {
-    position_byte = SettingsSetRequestPacket::VANE_SWING;
-  } else {
-    ESP_LOGW(TAG, "Unknown vane position %s", state.c_str());
+// Index is into VANE_POSITION_OPTIONS (which is also the vane select's option index)
+bool MitsubishiUART::select_vane_position(const size_t index) {
+  if (!VANE_POSITION_OPTIONS.has_index(index)) {
+    ESP_LOGW(TAG, "Unknown vane position %zu", index);
     return false;
   }
 
-  hp_bridge_.send_packet(SettingsSetRequestPacket().set_vane(position_byte));
+  pending_settings_.vane = VANE_POSITION_OPTIONS.value_at(index);
+  schedule_settings_flush_();
+  // The select publishes the new position straight away, so the position received next is always published
+  state_.forget(STATE_VANE);
   return true;
 }
 
-bool MitsubishiUART::select_horizontal_vane_position(const std::string &state) {
-  SettingsSetRequestPacket::HorizontalVaneByte position_byte = SettingsSetRequestPacket::HV_CENTER;
-
-  // NOTE: Annoyed that C++ doesn't have switches for strings, but since this is going to be called
-  // infrequently, this is probably a better solution than over-optimizing via maps or something
-
-  if (state == "Auto") {
-    position_byte = SettingsSetRequestPacket::HV_AUTO;
-  } else if (state == "<<") {
-    position_byte = SettingsSetRequestPacket::HV_LEFT_FULL;
-  } else if (state == "<") {
-    position_byte = SettingsSetRequestPacket::HV_LEFT;
-  } else if (state == "|") {
-    position_byte = SettingsSetRequestPacket::HV_CENTER;
-  } else if (state == ">") {
-    position_byte = SettingsSetRequestPacket::HV_RIGHT;
-  } else if (state == ">>") {
-    position_byte = SettingsSetRequestPacket::HV_RIGHT_FULL;
-  } else if (state == "<>") {
-    position_byte = SettingsSetRequestPacket::HV_SPLIT;
-  } else if (state == "Swing") {
-    position_byte = SettingsSetRequestPacket::HV_SWING;
-  } else {
-    ESP_LOGW(TAG, "Unknown horizontal vane position %s", state.c_str());
+// Index is into HORIZONTAL_VANE_POSITION_OPTIONS (which is also the horizontal vane select's option index)
+bool MitsubishiUART::select_horizontal_vane_position(const size_t index) {
+  if (!HORIZONTAL_VANE_POSITION_OPTIONS.has_index(index)) {
+    ESP_LOGW(TAG, "Unknown horizontal vane position %zu", index);
     return false;
   }
 
-  hp_bridge_.send_packet(SettingsSetRequestPacket().set_horizontal_vane(position_byte));
+  pending_settings_.horizontal_vane = HORIZONTAL_VANE_POSITION_OPTIONS.value_at(index);
+  schedule_settings_flush_();
+  // The select publishes the new position straight away, so the position received next is always published
+  state_.forget(STATE_HORIZONTAL_VANE);
   return true;
 }
 
 // Called by temperature_source sensors, and packetprocessing to report new temperature values. Only
 // sends temperature information on to heat pump if it matches the current selected_temperature_source
-void MitsubishiUART::temperature_source_report(const std::string &temperature_source, const float &v) {
-  ESP_LOGI(TAG, "Received temperature from %s of %f. (Current source: %s)", temperature_source.c_str(), v,
-           selected_temperature_source_.c_str());
+void MitsubishiUART::temperature_source_report(const uint8_t source, const float &v) {
+  // Internal isn't reported, and reports from sources that aren't options (e.g. no select) are of no use
+  if (source == TEMPERATURE_SOURCE_INTERNAL_ID || source >= temperature_source_count_) {
+    return;
+  }
+  TemperatureReport &report = temperature_reports_[source];
+
+  ESP_LOGI(TAG, "Received temperature from %s of %f. (Current source: %s)", report.name, v,
+           temperature_reports_[selected_temperature_source_].name);
 
   if (isnan(v) || v >= 63.5 || v <= -64.0) {
-    ESP_LOGW(TAG, "Temperature %f from %s is out of range and will be ignored.", v, temperature_source.c_str());
+    ESP_LOGW(TAG, "Temperature %f from %s is out of range and will be ignored.", v, report.name);
     return;
   }
 
-  // Record report in map
-  temperature_reports_[temperature_source].temperature = v;
-  temperature_reports_[temperature_source].timestamp = millis();
+  report.temperature = v;
+  report.timestamp = millis();
 
-  for (const auto &pair : temperature_reports_) {
-    ESP_LOGD(TAG, "%s: %f , %is ago", pair.first.c_str(), pair.second.temperature,
-             (millis() - pair.second.timestamp) / 1000);
+  for (uint8_t i = 1; i < temperature_source_count_; i++) {
+    ESP_LOGD(TAG, "%s: %f , %is ago", temperature_reports_[i].name, temperature_reports_[i].temperature,
+             (millis() - temperature_reports_[i].timestamp) / 1000);
   }
 
   // Only proceed if the incomming source matches our chosen source.
-  if (selected_temperature_source_ == temperature_source) {
+  if (selected_temperature_source_ == source) {
     // Reset the timeout for received temperature
     temperature_source_timeout_ = false;
 
-    // Tell the heat pump about the temperature asap, but don't worry about setting it locally, the next update() will
-    // get it
-    RemoteTemperatureSetRequestPacket pkt = RemoteTemperatureSetRequestPacket();
-    pkt.set_remote_temperature(v);
-    hp_bridge_.send_packet(pkt);
+    // Tell the heat pump about the temperature asap (if it's changed), but don't worry about setting it locally, the
+    // next update() will get it
+    send_remote_temperature_(v, false);
 
-    // If we're using echos, update the last sent so the echo waits properly
-    if (temperature_source_echo_ms_ > 0) {
-      temperature_source_echo_last_timestamp_ = millis();
-    }
+    // Restart the timeout
+    arm_temperature_source_timeout_(temperature_source_timout_ms_);
 
     // If we've sent a remote temperature, we're not using the internal one
     alert_listeners_internal_temp_(false);
   }
 }
 
+// Reverts to the Internal source if no report for the selected source is received within delay_ms.  Not armed once
+// the source has timed out (until it reports again).
+void MitsubishiUART::arm_temperature_source_timeout_(const uint32_t delay_ms) {
+  if (temperature_source_timeout_) {
+    return;
+  }
+
+  set_timeout("temperature_source_timeout", delay_ms, [this]() {
+    // Alert user and set heatpump to internal
+    ESP_LOGW(TAG, "No temperature received from %s for %lu milliseconds, reverting to Internal source",
+             temperature_reports_[selected_temperature_source_].name, (unsigned long) temperature_source_timout_ms_);
+    // Let listeners know we've changed to the Internal temperature source (but do not change
+    // selected_temperature_source)
+    alert_listeners_internal_temp_(true);
+    temperature_source_timeout_ = true;
+    cancel_timeout("temperature_source_echo");
+    last_remote_temperature_ = REMOTE_TEMPERATURE_NONE;
+    // Send a packet to the heat pump to tell it to switch to internal temperature sensing
+    hp_bridge_.send_packet(RemoteTemperatureSetRequestPacket().set_use_internal_temperature(true),
+                           PacketPriority::REMOTE_TEMPERATURE);
+  });
+}
+
+// Resends the selected source's last temperature if nothing has been sent for the echo interval.  Like the timeout,
+// it isn't armed once the source has timed out, so a silent source's last reading isn't echoed indefinitely.
+void MitsubishiUART::arm_temperature_source_echo_() {
+  if (temperature_source_echo_ms_ == 0 || temperature_source_timeout_) {
+    return;
+  }
+
+  set_timeout("temperature_source_echo", temperature_source_echo_ms_, [this]() {
+    const float temperature = temperature_reports_[selected_temperature_source_].temperature;
+    // Nothing to echo; the next report will send (and re-arm) instead
+    if (isnan(temperature)) {
+      return;
+    }
+
+    ESP_LOGD(TAG, "Echoing last received temperature");
+    send_remote_temperature_(temperature, true);
+  });
+}
+
+/* Sends a remote temperature, unless the heat pump already has it (at the packet's half degree resolution) and it was
+sent recently enough that the heat pump won't have reverted to its own sensor.  Sensors often report far more often
+(and more precisely) than the heat pump can use, so this keeps those reports off the bus.*/
+void MitsubishiUART::send_remote_temperature_(const float temperature, const bool force) {
+  const int16_t half_degrees = static_cast<int16_t>(lroundf(temperature * 2));
+  const uint32_t keepalive_ms =
+      temperature_source_echo_ms_ > 0 ? temperature_source_echo_ms_ : REMOTE_TEMPERATURE_KEEPALIVE_MS;
+  const uint32_t now = millis();
+
+  if (!force && half_degrees == last_remote_temperature_ && now - last_remote_temperature_ms_ < keepalive_ms) {
+    ESP_LOGV(TAG, "Remote temperature %.1f unchanged, not sent.", temperature);
+    return;
+  }
+
+  if (!hp_bridge_.send_packet(RemoteTemperatureSetRequestPacket().set_remote_temperature(temperature),
+                              PacketPriority::REMOTE_TEMPERATURE)) {
+    // The echo re-arms itself from here, so it still needs arming to try again (and keep the heat pump from reverting)
+    arm_temperature_source_echo_();
+    return;
+  }
+  last_remote_temperature_ = half_degrees;
+  last_remote_temperature_ms_ = now;
+  // The current temperature the heat pump reports is the remote temperature
+  response_cache_.invalidate(GetCommand::CURRENT_TEMP);
+  // The echo waits from the last send
+  arm_temperature_source_echo_();
+}
+
 void MitsubishiUART::reset_filter_status() {
   ESP_LOGI(TAG, "Received a request to reset the filter status.");
 
   SetRunStatePacket pkt = SetRunStatePacket();
   pkt.set_filter_reset(true);
-  hp_bridge_.send_packet(pkt);
+  if (!hp_bridge_.send_request<SetResponsePacket>(
+          pkt, PacketPriority::COMMAND, [this](const RequestStatus status, const SetResponsePacket *response) {
+            if (response == nullptr) {
+              ESP_LOGW(TAG, "Filter reset was not answered by the heat pump.");
+            } else if (!response->is_successful()) {
+              ESP_LOGW(TAG, "Filter reset was rejected by the heat pump (code = %x).", response->get_result_code());
+            } else {
+              // Pick up the cleared filter status now, rather than on the next poll
+              this->response_cache_.invalidate(GetCommand::RUN_STATE);
+              this->hp_bridge_.send_packet(GET_RUN_STATE_FRAME, PacketPriority::COMMAND);
+            }
+          })) {
+    ESP_LOGW(TAG, "Filter reset could not be queued.");
+  }
 }
 
 }  // namespace mitsubishi_itp
@@ -8,11 +8,18 @@
 #endif
 #include "esphome/components/climate/climate.h"
 #include "mitp_listener.h"
+#include "mitp_listener_table.h"
 #include "itp_packets.h"
 #include "itp_packetprocessor.h"
 #include "mitp_bridge.h"
 #include "mitp_mhk.h"
-#include <map>
+#include "mitp_options.h"
+#include "mitp_poll_scheduler.h"
+#include "mitp_preferences.h"
+#include "mitp_response_cache.h"
+#include "mitp_state.h"
+#include <array>
+#include <cstring>
 
 using namespace itp_packet;
 
@@ -24,12 +31,98 @@ static constexpr char TAG[] = "mitsubishi_itp";
 const uint8_t MITP_MIN_TEMP = 16;  // Degrees C
 const uint8_t MITP_MAX_TEMP = 31;  // Degrees C
 const float MITP_TEMPERATURE_STEP = 0.5;
+// Changes are published this long after they're received, so changes from several packets are published together
+const uint32_t PUBLISH_DELAY_MS = 10;
+// Changed preferences are written once they've stopped changing for this long (or on shutdown)
+const uint32_t PREFERENCES_COMMIT_DELAY_MS = 10000;
+/* Link watchdog defaults.  The heat pump is considered gone once this many requests in a row go unanswered, or
+nothing's been received from it for this long (0 to only go by timeouts).  Connect requests are then resent, starting
+at the reconnect interval and doubling up to the maximum, until it answers again.*/
+const uint8_t LINK_MAX_TIMEOUTS = 3;
+const uint32_t LINK_SILENCE_TIMEOUT_MS = 30000;
+const uint32_t RECONNECT_MIN_INTERVAL_MS = 1000;
+const uint32_t RECONNECT_MAX_INTERVAL_MS = 30000;
+// Bump if MITPPreferences or WarmStartCache change, so what's saved by an older version isn't misread
+const uint32_t PREFERENCES_VERSION = 1;
 
 inline const char* TEMPERATURE_SOURCE_INTERNAL = "Internal";
 inline const char* TEMPERATURE_SOURCE_THERMOSTAT = "Thermostat";
+// Temperature sources are identified by their index in the temperature source select's options (Internal is always
+// first).  IDs are assigned during codegen, so no strings are involved once running.
+const uint8_t MAX_TEMPERATURE_SOURCES = 8;
+const uint8_t TEMPERATURE_SOURCE_INTERNAL_ID = 0;
+const uint8_t TEMPERATURE_SOURCE_NONE = 0xFF;
+// Unchanged remote temperatures are still resent this often (if there's no echo), as some heat pumps revert to their
+// internal sensor after as little as a minute without one
+const uint32_t REMOTE_TEMPERATURE_KEEPALIVE_MS = 30000;
 
 const auto MAX_RECALL_MODE_INDEX = climate::ClimateMode::CLIMATE_MODE_DRY;
 
+// The user-settable fields of the heat pump's settings.  Unset fields are unknown (or unchanged).
+struct HeatpumpSettings {
+  optional<bool> power;
+  optional<SettingsSetRequestPacket::ModeByte> mode;
+  optional<float> target_temperature;
+  optional<SettingsSetRequestPacket::FanByte> fan;
+  optional<SettingsSetRequestPacket::VaneByte> vane;
+  optional<SettingsSetRequestPacket::HorizontalVaneByte> horizontal_vane;
+
+  // Whether every set field matches a received settings packet (setpoints at the packet's half degree resolution)
+  bool matches(const SettingsGetResponsePacket &packet) const;
+};
+
+/* Settings GET responses report some modes with values that aren't valid in a SET request: the i-see variants of heat,
+dry and cool (0x09-0x0B), and the Kumo auto modes (0x21, 0x23).  Maps a reported mode to the SET encoding of the same
+mode (read the same way as apply_climate_settings_() does).*/
+inline SettingsSetRequestPacket::ModeByte to_set_mode_byte(const uint8_t mode) {
+  switch (mode) {
+    case 0x09:
+      return SettingsSetRequestPacket::MODE_BYTE_HEAT;
+    case 0x0A:
+      return SettingsSetRequestPacket::MODE_BYTE_DRY;
+    case 0x0B:
+      return SettingsSetRequestPacket::MODE_BYTE_COOL;
+    case 0x21:
+    case 0x23:
+      return SettingsSetRequestPacket::MODE_BYTE_AUTO;
+    default:
+      return static_cast<SettingsSetRequestPacket::ModeByte>(mode);
+  }
+}
+
+struct MITPPreferences {
+  // Array stores a float setpoint for each climate mode up to DRY.
+  std::array<float, MAX_RECALL_MODE_INDEX + 1> modeRecallSetpoints = {0.0f};
+};
+
+// A packet's bytes, in a form that can be saved to preferences
+struct PersistedPacket {
+  uint8_t length = 0;  // 0 if there's no packet
+  uint8_t bytes[PACKET_MAX_SIZE] = {};
+
+  void assign(const Packet &packet) {
+    // raw_packet() isn't const, but it's only read from here
+    const RawPacket &raw = const_cast<Packet &>(packet).raw_packet();
+    length = raw.get_length();
+    std::memset(bytes, 0, sizeof(bytes));
+    std::memcpy(bytes, raw.get_bytes(), length);
+  }
+  bool has_value() const { return length > 0 && length <= PACKET_MAX_SIZE; }
+  bool matches(const Packet &packet) const {
+    const RawPacket &raw = const_cast<Packet &>(packet).raw_packet();
+    return raw.get_length() == length && std::memcmp(raw.get_bytes(), bytes, length) == 0;
+  }
+  RawPacket to_raw_packet() const { return RawPacket(bytes, length); }
+};
+
+/* What's been learned about the heat pump, so a restart can start from it rather than waiting to rediscover it (and
+show the last known state, rather than nothing, until the heat pump has responded).*/
+struct WarmStartCache {
+  PersistedPacket capabilities;
+  PersistedPacket settings;        // Last settings received
+  uint8_t unsupported_polls = 0;  // See PollScheduler::get_unsupported()
+};
+
 class MitsubishiUART : public PollingComponent, public climate::Climate, public PacketProcessor {
  public:
   /**
@@ -58,6 +151,10 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
   // Dumps some configuration data that we may have missed in the real-time logs
   void dump_config() override;
 
+  // Commits any changed preferences before they're lost
+  void on_safe_shutdown() override { commit_preferences_(); }
+  void on_shutdown() override { commit_preferences_(); }
+
   // Called to instruct a change of the climate controls
   void control(const climate::ClimateCall &call) override;
 
@@ -65,38 +162,86 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
   void set_thermostat_uart(uart::UARTComponent *uart);
 
   // Listener-sensors
-  void register_listener(MITPListener *listener) { this->listeners_.push_back(listener); }
+  void register_listener(MITPListener *listener);
+  // Used instead of registering each listener when static_listeners is enabled
+  void set_listener_table(ListenerTable *table) { this->listener_table_ = table; }
 
   // Temperature Source config
   void set_temperature_source_timeout_ms(const uint32_t timeout) { this->temperature_source_timout_ms_ = timeout; }
   void set_temperature_source_echo_ms(const uint32_t echo_interval) {
     this->temperature_source_echo_ms_ = echo_interval;
   }
+  // Sources are added in the order of the select's options, after Internal
+  void add_temperature_source(const char *name);
+  void set_thermostat_temperature_source(const uint8_t source) { this->thermostat_temperature_source_ = source; }
 
   // Returns true if select was valid (even if not yet successful) to indicate select component
   // should optimistically publish
-  bool select_temperature_source(const std::string &state);
-  bool select_vane_position(const std::string &state);
-  bool select_horizontal_vane_position(const std::string &state);
+  bool select_temperature_source(uint8_t source);
+  bool select_vane_position(size_t index);
+  bool select_horizontal_vane_position(size_t index);
 
   // Used by external sources to report a temperature
-  void temperature_source_report(const std::string &temperature_source, const float &v);
+  void temperature_source_report(uint8_t source, const float &v);
 
   // Button triggers
   void reset_filter_status();
 
+  // Preferences (of the hub or its listeners) committed together, after they stop changing
+  void register_preference(DirtyPreference *preference) { registered_preferences_.push_back(preference); }
+  void schedule_preferences_commit();
+
   // Turns on or off Kumo emulation mode
   void set_enhanced_mhk_support(const bool supports) { enhanced_mhk_support_ = supports; }
 
   // Enables the recall setpoint feature
   void set_recall_setpoint(const bool enabled) { recall_setpoint_ = enabled; }
 
+  // Sets what the heat pump bridge does when its send queue is full
+  void set_queue_overflow_policy(const QueueOverflowPolicy policy) { hp_bridge_.set_overflow_policy(policy); }
+
+  // Sets how many requests can be waiting on a response from the heat pump at once
+  void set_in_flight_window(const uint8_t window) { hp_bridge_.set_in_flight_window(window); }
+
+  // Forward pass-through packets as soon as they're received instead of queueing them
+  void set_passthrough_cut_through(const bool enabled) { passthrough_cut_through_ = enabled; }
+
+  // Polling config
+  void set_poll_interval(const GetCommand command, const uint32_t interval) {
+    poll_scheduler_.set_interval(command, interval);
+  }
+  void set_poll_off_interval(const uint32_t interval) { poll_scheduler_.set_off_interval(interval); }
+  void set_poll_boost(const uint32_t interval, const uint32_t duration) {
+    poll_scheduler_.set_boost(interval, duration);
+  }
+
+  // Link watchdog config
+  void set_link_timeout(const uint8_t max_timeouts, const uint32_t silence_ms) {
+    link_max_timeouts_ = max_timeouts;
+    link_silence_timeout_ms_ = silence_ms;
+  }
+  void set_reconnect_interval(const uint32_t min_interval_ms, const uint32_t max_interval_ms) {
+    reconnect_min_interval_ms_ = min_interval_ms;
+    reconnect_max_interval_ms_ = max_interval_ms;
+    reconnect_interval_ms_ = min_interval_ms;
+  }
+
+  // Answers the thermostat's GET requests for command from responses up to ttl old, rather than forwarding them
+  void set_thermostat_proxy_ttl(const GetCommand command, const uint32_t ttl_ms) {
+    thermostat_proxy_ = true;
+    response_cache_.set_ttl(command, ttl_ms);
+  }
+
+  // Settings changes made within this window are merged and sent as a single packet
+  void set_settings_debounce_ms(const uint32_t debounce) { settings_debounce_ms_ = debounce; }
+
 #ifdef USE_TIME
   void set_time_source(time::RealTimeClock *rtc) { time_source_ = rtc; }
 #endif
 
  protected:
   void route_packet_(const Packet &packet);
+  bool is_passthrough_only_(const RawPacket &pkt) const;
 
   void process_packet(const Packet &packet) override;
   void process_packet(const ConnectRequestPacket &packet) override;
@@ -123,6 +268,15 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
   void handle_thermostat_ab_get_request(const GetRequestPacket &packet) override;
 
   void do_publish_();
+  void schedule_publish_();
+  void publish_changes_();
+
+  // Settings changes
+  void schedule_settings_flush_();
+  void flush_settings_();
+  void handle_settings_set_response_(uint32_t generation, RequestStatus status, const SetResponsePacket *response);
+  void confirm_settings_(const SettingsGetResponsePacket &packet, bool rejected);
+  void settings_unanswered_();
 
  private:
   // Default climate_traits for MITP
@@ -149,17 +303,37 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
 
   // Are we connected to the heatpump?
   bool hp_connected_ = false;
-  // Should we call publish on the next update?
-  bool publish_on_update_ = false;
-  // Are we still discovering information about the device?
-  bool in_discovery_ = true;
-  // Number of times update() has been called in discovery mode
-  size_t discovery_updates_ = 0;
+  // Link watchdog
+  void set_connected_(bool connected);
+  void check_link_(uint32_t now);
+  void send_connect_();
+  uint8_t link_max_timeouts_ = LINK_MAX_TIMEOUTS;
+  uint32_t link_silence_timeout_ms_ = LINK_SILENCE_TIMEOUT_MS;
+  uint32_t reconnect_min_interval_ms_ = RECONNECT_MIN_INTERVAL_MS;
+  uint32_t reconnect_max_interval_ms_ = RECONNECT_MAX_INTERVAL_MS;
+  uint32_t reconnect_interval_ms_ = RECONNECT_MIN_INTERVAL_MS;  // Until the next connect request
+  uint32_t reconnects_ = 0;                                     // Since boot
+  // Last known state of the heat pump, tracks what's changed since the last publish
+  HeatpumpState state_;
+  // Is a publish of changes already scheduled?
+  bool publish_scheduled_ = false;
 
   optional<CapabilitiesResponsePacket> capabilities_cache_;
   bool capabilities_requested_ = false;
-  // Have we received at least one RunState response?
-  bool run_state_received_ = false;
+
+  void restore_warm_start_();
+  // Applies settings to the climate's state, returns true if anything changed
+  bool apply_climate_settings_(const SettingsGetResponsePacket &packet);
+  DebouncedPreference<WarmStartCache> warm_start_;
+
+  // Decides when to request updates from the heatpump
+  PollScheduler poll_scheduler_;
+
+  // Thermostat proxy
+  bool answer_from_cache_(const GetRequestPacket &packet);
+  void cache_response_(const Packet &packet);
+  bool thermostat_proxy_ = false;
+  ResponseCache response_cache_;
 
 // Time Source
 #ifdef USE_TIME
@@ -169,35 +343,106 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
 
   // Listener-sensors
   std::vector<MITPListener *> listeners_{};
-  template<typename T> void alert_listeners_packet_(const T &packet) const {
-    for (auto *listener : this->listeners_) {
+  // Listeners bound to each state field, so only the listeners of changed fields are asked to publish
+  std::array<std::vector<MITPListener *>, STATE_FIELD_COUNT> field_listeners_{};
+  // Listeners subscribed to each event, so each packet is only passed to the listeners that handle it
+  std::array<std::vector<MITPListener *>, LISTENER_EVENT_COUNT> event_listeners_{};
+  // Listeners wired up at compile time, if any
+  ListenerTable *listener_table_ = nullptr;
+  // Listeners decide for themselves if anything changed, so a publish is scheduled after every alert
+  template<typename T> void alert_listeners_packet_(const T &packet) {
+    for (auto *listener : this->event_listeners_[listener_event_of<T>()]) {
       listener->process_packet(packet);
     }
+    if (this->listener_table_ != nullptr) {
+      this->listener_table_->process_packet(packet);
+    }
+    schedule_publish_();
   }
-  void alert_listeners_internal_temp_(const bool using_internal) const {
-    for (auto *listener : this->listeners_) {
+  void alert_listeners_internal_temp_(const bool using_internal) {
+    for (auto *listener : this->event_listeners_[LISTENER_EVENT_USING_INTERNAL_TEMPERATURE]) {
       listener->using_internal_temperature(using_internal);
     }
+    if (this->listener_table_ != nullptr) {
+      this->listener_table_->using_internal_temperature(using_internal);
+    }
+    state_.update(STATE_USING_INTERNAL_TEMPERATURE, state_.using_internal_temperature, using_internal);
+    schedule_publish_();
+  }
+  void alert_listeners_passthrough_latency_(const float latency_ms) {
+    for (auto *listener : this->event_listeners_[LISTENER_EVENT_PASSTHROUGH_LATENCY]) {
+      listener->passthrough_latency(latency_ms);
+    }
+    if (this->listener_table_ != nullptr) {
+      this->listener_table_->passthrough_latency(latency_ms);
+    }
+    state_.update(STATE_PASSTHROUGH_LATENCY, state_.passthrough_latency_ms, latency_ms);
+    schedule_publish_();
+  }
+  void alert_listeners_preference_saves_(const uint32_t saves) {
+    for (auto *listener : this->event_listeners_[LISTENER_EVENT_PREFERENCE_SAVES]) {
+      listener->preference_saves(saves);
+    }
+    if (this->listener_table_ != nullptr) {
+      this->listener_table_->preference_saves(saves);
+    }
+    state_.update(STATE_PREFERENCE_SAVES, state_.preference_saves, saves);
+    schedule_publish_();
+  }
+  void alert_listeners_link_state_(const bool connected, const uint32_t reconnects) {
+    for (auto *listener : this->event_listeners_[LISTENER_EVENT_LINK_STATE]) {
+      listener->link_state(connected, reconnects);
+    }
+    if (this->listener_table_ != nullptr) {
+      this->listener_table_->link_state(connected, reconnects);
+    }
+    state_.update(STATE_CONNECTED, state_.connected, connected);
+    state_.update(STATE_RECONNECTS, state_.reconnects, reconnects);
+    schedule_publish_();
+  }
+  void alert_listeners_command_result_(const CommandResult result) {
+    for (auto *listener : this->event_listeners_[LISTENER_EVENT_COMMAND_RESULT]) {
+      listener->command_result(result);
+    }
+    if (this->listener_table_ != nullptr) {
+      this->listener_table_->command_result(result);
+    }
+    state_.update(STATE_COMMAND_RESULT, state_.command_result, static_cast<uint8_t>(result));
+    schedule_publish_();
   }
 
   // Temperature select extras
   struct TemperatureReport {
+    const char *name = nullptr;
     float temperature = NAN;
     uint32_t timestamp = 0;  // From millis() (not actual time)
   };
 
   // Initialize to internal so this isn't undefined
-  std::string selected_temperature_source_ = TEMPERATURE_SOURCE_INTERNAL;
+  uint8_t selected_temperature_source_ = TEMPERATURE_SOURCE_INTERNAL_ID;
   bool temperature_source_timeout_ = false;  // Has the current source timed out?
-  std::map<std::string, TemperatureReport> temperature_reports_;
+  // Indexed by source ID
+  std::array<TemperatureReport, MAX_TEMPERATURE_SOURCES> temperature_reports_{{{TEMPERATURE_SOURCE_INTERNAL}}};
+  uint8_t temperature_source_count_ = 1;
+  uint8_t thermostat_temperature_source_ = TEMPERATURE_SOURCE_NONE;
   uint32_t temperature_source_timout_ms_ =
       420000;  // 7min default, some heat pumps revert on their own after 10min, some ~60seconds
-  uint32_t temperature_source_echo_ms_ = 0;              // 0 = off by default
-  uint32_t temperature_source_echo_last_timestamp_ = 0;  // Timestamp of last sent temperature
+  uint32_t temperature_source_echo_ms_ = 0;  // 0 = off by default
+  // The timeout and echo are scheduled deadlines, re-armed by reports from the selected source
+  void arm_temperature_source_timeout_(uint32_t delay_ms);
+  void arm_temperature_source_echo_();
+  void send_remote_temperature_(float temperature, bool force);
+  // Last remote temperature sent, in half degrees (the packet's resolution)
+  static const int16_t REMOTE_TEMPERATURE_NONE = INT16_MIN;
+  int16_t last_remote_temperature_ = REMOTE_TEMPERATURE_NONE;
+  uint32_t last_remote_temperature_ms_ = 0;
 
   // used to track whether to support/handle the enhanced MHK protocol packets
   bool enhanced_mhk_support_ = false;
 
+  // If enabled, packets that only need relaying are forwarded as soon as they're received
+  bool passthrough_cut_through_ = false;
+
   // If enabled, switching modes will recall target mode's previous setpoint
   bool recall_setpoint_ = false;
   // Array stores a float setpoint for each climate mode up to DRY.
@@ -205,15 +450,24 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
 
   MHKState mhk_state_;
 
+  /* Settings changes not yet sent, and the last known (received or sent) settings of the heat pump.  Changes matching
+  the known settings aren't sent, so they're forgotten whenever something else is seen changing the settings.*/
+  HeatpumpSettings pending_settings_;
+  HeatpumpSettings known_settings_;
+  uint32_t settings_debounce_ms_ = 100;
+  bool settings_flush_scheduled_ = false;
+  // Read-after-write confirmation of the last settings change sent
+  HeatpumpSettings commanded_settings_;  // Fields that were sent
+  uint32_t settings_generation_ = 0;     // Bumped for each change sent, so only the latest is confirmed
+  bool settings_confirming_ = false;     // Sent and not yet confirmed, so differences may be our own change
+
   // Preferences
   void save_preferences_();
   void restore_preferences_();
-  ESPPreferenceObject preferences_;
-};
-
-struct MITPPreferences {
-  // Array stores a float setpoint for each climate mode up to DRY.
-  std::array<float, MAX_RECALL_MODE_INDEX + 1> modeRecallSetpoints = {0.0f};
+  void commit_preferences_();
+  DebouncedPreference<MITPPreferences> preferences_;
+  std::vector<DirtyPreference *> registered_preferences_{};
+  uint32_t preference_saves_ = 0;  // Since boot (see commit_preferences_())
 };
 
 }  // namespace mitsubishi_itp
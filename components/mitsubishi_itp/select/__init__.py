@@ -9,17 +9,24 @@ from esphome.const import (
 )
 from esphome.core import CORE, coroutine
 
-from ...mitsubishi_itp import CONF_MITSUBISHI_ITP_ID, MitsubishiUART, mitsubishi_itp_ns
+from ...mitsubishi_itp import (
+    CONF_MITSUBISHI_ITP_ID,
+    MitsubishiUART,
+    mitsubishi_itp_ns,
+    register_listener,
+)
 from ..climate import CONF_UART_THERMOSTAT
 
 CONF_TEMPERATURE_SOURCE = (
     "temperature_source"  # This is to create a Select object for selecting a source
 )
 CONF_SOURCES = "sources"  # This is for specifying additional sources
+MAX_TEMPERATURE_SOURCES = 8  # Must match MAX_TEMPERATURE_SOURCES in mitsubishi_itp.h
 CONF_ECHO_INTERVAL = "echo_interval"
 CONF_VANE_POSITION = "vane_position"
 CONF_HORIZONTAL_VANE_POSITION = "horizontal_vane_position"
 
+# Must match the order of VANE_POSITION_OPTIONS and HORIZONTAL_VANE_POSITION_OPTIONS in mitp_options.h
 VANE_POSITIONS = ["Auto", "1", "2", "3", "4", "5", "Swing"]
 HORIZONTAL_VANE_POSITIONS = ["Auto", "<<", "<", "|", ">", ">>", "<>", "Swing"]
 
@@ -39,8 +46,10 @@ SELECTS = {
             icon="mdi:thermometer-check",
         ).extend(
             {
-                cv.Optional(CONF_SOURCES, default=[]): cv.ensure_list(
-                    cv.use_id(sensor.Sensor)
+                # Internal and Thermostat take up two of the hub's MAX_TEMPERATURE_SOURCES
+                cv.Optional(CONF_SOURCES, default=[]): cv.All(
+                    cv.ensure_list(cv.use_id(sensor.Sensor)),
+                    cv.Length(max=MAX_TEMPERATURE_SOURCES - 2),
                 ),
                 cv.Optional(CONF_TIMEOUT, default="8min"): cv.All(
                     cv.positive_time_period_seconds,
@@ -99,6 +108,12 @@ CONFIG_SCHEMA = cv.Schema(
 )
 
 
+def add_temperature_source(mitp_component, select_options, name):
+    """Adds a temperature source option.  Its ID is its index in the select's options."""
+    select_options.append(name)
+    cg.add(getattr(mitp_component, "add_temperature_source")(name))
+
+
 @coroutine
 async def to_code(config):
     mitp_component = await cg.get_variable(config[CONF_MITSUBISHI_ITP_ID])
@@ -106,11 +121,17 @@ async def to_code(config):
     # Register selects
     for select_designator, (
         _,
-        select_options,
+        default_options,
     ) in SELECTS.items():
         if select_conf := config.get(select_designator):
+            select_options = list(default_options)
             select_component = cg.new_Pvariable(select_conf[CONF_ID])
-            cg.add(getattr(mitp_component, "register_listener")(select_component))
+            register_listener(
+                mitp_component,
+                config[CONF_MITSUBISHI_ITP_ID],
+                select_component,
+                select_conf[CONF_ID],
+            )
 
             if select_designator == CONF_TEMPERATURE_SOURCE:
                 # Check to see if the associated climate has a thermostat defined
@@ -121,22 +142,29 @@ async def to_code(config):
                         climate_entry.get(CONF_ID) == config[CONF_MITSUBISHI_ITP_ID]
                         and CONF_UART_THERMOSTAT in climate_entry):
                             # If so, add Thermostat as a temperature source option
-                            select_options.append(mitsubishi_itp_ns.TEMPERATURE_SOURCE_THERMOSTAT)
+                            add_temperature_source(
+                                mitp_component,
+                                select_options,
+                                mitsubishi_itp_ns.TEMPERATURE_SOURCE_THERMOSTAT,
+                            )
+                            cg.add(
+                                getattr(
+                                    mitp_component, "set_thermostat_temperature_source"
+                                )(len(select_options) - 1)
+                            )
 
                 # Add additional configured temperature sensors to the select menu
                 for ts_id in select_conf[CONF_SOURCES]:
                     ts = await cg.get_variable(ts_id)
-                    select_options.append(ts.get_name().c_str())
-                    # cg.add(
-                    #     getattr(select_component, "register_temperature_source")(
-                    #         ts.get_name().str()
-                    #     )
-                    # )
+                    add_temperature_source(
+                        mitp_component, select_options, ts.get_name().c_str()
+                    )
+                    # Sources report by ID (their option index), so no strings are passed on each reading
                     cg.add(
                         getattr(ts, "add_on_state_callback")(
                             # TODO: Is there anyway to do this without a raw expression?
                             cg.RawExpression(
-                                f"[](float v){{{getattr(mitp_component, 'temperature_source_report')}({ts.get_name()}, v);}}"
+                                f"[](float v){{{getattr(mitp_component, 'temperature_source_report')}({len(select_options) - 1}, v);}}"
                             )
                         )
                     )
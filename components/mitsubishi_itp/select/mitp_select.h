@@ -10,51 +10,71 @@ class MITPSelect : public select::Select, public Parented<MitsubishiUART>, publi
  public:
   MITPSelect() = default;
   using Parented<MitsubishiUART>::Parented;
-  void publish() override {
-    // Only publish if force, or a change has occurred and we have a real value
-    if (mitp_select_value_.has_value() && mitp_select_value_.value() != current_option()) {
-      publish_state(mitp_select_value_.value());
+  void publish() override { publish_index_(); }
+
+ protected:
+  // Only publishes if a change has occurred and we have a real value.  Returns true if published.
+  bool publish_index_() {
+    if (!mitp_select_index_.has_value() || mitp_select_index_ == published_index_) {
+      return false;
     }
+    published_index_ = mitp_select_index_;
+    publish_state(mitp_select_index_.value());
+    return true;
   }
 
- protected:
   void control(const std::string &value) override = 0;
-  optional<std::string> mitp_select_value_;
+  // Index of the selected option.  Selects track indexes rather than strings, so changes are detected cheaply.
+  optional<size_t> mitp_select_index_;
+
+ private:
+  optional<size_t> published_index_;
 };
 
 class TemperatureSourceSelect : public MITPSelect {
  public:
+  // Only changed by control(), which publishes itself
+  uint32_t get_state_fields() const override { return STATE_FIELDS_NONE; }
+  uint32_t get_subscriptions() const override { return LISTENER_EVENTS_NONE; }
   void publish() override;
   void setup() override;
 
  protected:
   void control(const std::string &value) override;
+  // Option indexes are the hub's temperature source IDs
+  void select_source_(size_t index);
 
  private:
-  ESPPreferenceObject preferences_;
-  esphome::FixedVector<const char*> temp_select_options_ = {
-      TEMPERATURE_SOURCE_INTERNAL};  // Used to map strings to indexes for preference storage
+  DebouncedPreference<size_t> preference_;
 };
 
 class VanePositionSelect : public MITPSelect {
+ public:
+  uint32_t get_state_fields() const override { return STATE_VANE; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_SETTINGS_GET_RESPONSE); }
   void process_packet(const SettingsGetResponsePacket &packet) override;
 
  protected:
   void control(const std::string &value) override {
-    if (parent_->select_vane_position(value)) {
-      mitp_select_value_ = value;
+    auto index = VANE_POSITION_OPTIONS.index_of(value);
+    if (index.has_value() && parent_->select_vane_position(index.value())) {
+      mitp_select_index_ = index;
       publish();
     }
   }
 };
 
 class HorizontalVanePositionSelect : public MITPSelect {
+ public:
+  uint32_t get_state_fields() const override { return STATE_HORIZONTAL_VANE; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_SETTINGS_GET_RESPONSE); }
   void process_packet(const SettingsGetResponsePacket &packet) override;
 
  protected:
   void control(const std::string &value) override {
-    if (parent_->select_horizontal_vane_position(value)) {
-      mitp_select_value_ = value;
+    auto index = HORIZONTAL_VANE_POSITION_OPTIONS.index_of(value);
+    if (index.has_value() && parent_->select_horizontal_vane_position(index.value())) {
+      mitp_select_index_ = index;
       publish();
     }
   }
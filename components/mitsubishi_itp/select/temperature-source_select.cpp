@@ -4,12 +4,8 @@ namespace esphome {
 namespace mitsubishi_itp {
 
 void TemperatureSourceSelect::publish() {
-  // Only publish if force, or a change has occurred and we have a real value
-  if (mitp_select_value_.has_value() && mitp_select_value_.value() != current_option()) {
-    publish_state(mitp_select_value_.value());
-    if (active_index().has_value()) {
-      preferences_.save(&active_index().value());
-    }
+  if (publish_index_() && preference_.set(mitp_select_index_.value())) {
+    parent_->schedule_preferences_commit();
   }
 }
 
@@ -17,20 +13,27 @@ void TemperatureSourceSelect::setup() {
 
   // Using App.get_compilation_time() means these will get reset each time the firmware is updated, but this
   // is an easy way to prevent wierd conflicts if e.g. select options change.
-  this->preferences_ =
-      global_preferences->make_preference<size_t>(this->get_object_id_hash() ^ fnv1_hash(App.get_compilation_time()));
+  this->preference_.init(
+      global_preferences->make_preference<size_t>(this->get_object_id_hash() ^ fnv1_hash(App.get_compilation_time())));
+  parent_->register_preference(&this->preference_);
 
-  size_t saved_index;
-  if (this->preferences_.load(&saved_index) && has_index(saved_index) && at(saved_index).has_value()) {
-    control(at(saved_index).value());
+  if (this->preference_.load() && has_index(this->preference_.get())) {
+    select_source_(this->preference_.get());
   } else {
-    control(TEMPERATURE_SOURCE_INTERNAL);  // Set to internal if no preferences loaded.
+    select_source_(TEMPERATURE_SOURCE_INTERNAL_ID);  // Set to internal if no preferences loaded.
   }
 }
 
 void TemperatureSourceSelect::control(const std::string &value) {
-  if (parent_->select_temperature_source(value)) {
-    mitp_select_value_ = value;
+  auto index = index_of(value);
+  if (index.has_value()) {
+    select_source_(index.value());
+  }
+}
+
+void TemperatureSourceSelect::select_source_(const size_t index) {
+  if (parent_->select_temperature_source(index)) {
+    mitp_select_index_ = index;
     publish();
   }
 }
@@ -1,6 +1,8 @@
+import esphome.codegen as cg
 from esphome.components import sensor
 import esphome.config_validation as cv
 from esphome.const import (
+    CONF_ID,
     CONF_OUTDOOR_TEMPERATURE,
     DEVICE_CLASS_DURATION,
     DEVICE_CLASS_ENERGY,
@@ -9,11 +11,13 @@ from esphome.const import (
     DEVICE_CLASS_POWER,
     DEVICE_CLASS_TEMPERATURE,
     ENTITY_CATEGORY_DIAGNOSTIC,
+    ICON_TIMER,
     STATE_CLASS_MEASUREMENT,
     STATE_CLASS_TOTAL_INCREASING,
     UNIT_CELSIUS,
     UNIT_HERTZ,
     UNIT_KILOWATT_HOURS,
+    UNIT_MILLISECOND,
     UNIT_MINUTE,
     UNIT_PERCENT,
     UNIT_WATT
@@ -30,8 +34,16 @@ CONF_THERMOSTAT_HUMIDITY = "thermostat_humidity"
 CONF_THERMOSTAT_TEMPERATURE = "thermostat_temperature"
 CONF_INPUT_WATTS = "input_watts"
 CONF_LIFETIME_KWH = "lifetime_kwh"
+CONF_PASSTHROUGH_LATENCY = "passthrough_latency"
+CONF_PREFERENCE_SAVES = "preference_saves"
+CONF_RECONNECTS = "reconnects"
 CONF_RUNTIME = "runtime"
 
+CONF_DEADBAND = "deadband"
+CONF_MIN_PUBLISH_INTERVAL = "min_publish_interval"
+CONF_MAX_PUBLISH_INTERVAL = "max_publish_interval"
+CONF_AVERAGE_WINDOW = "average_window"
+
 CompressorFrequencySensor = mitsubishi_itp_ns.class_(
     "CompressorFrequencySensor", sensor.Sensor
 )
@@ -41,6 +53,13 @@ InputWattsSensor = mitsubishi_itp_ns.class_(
 LifetimeKwhSensor = mitsubishi_itp_ns.class_(
     "LifetimeKwhSensor", sensor.Sensor
 )
+PassthroughLatencySensor = mitsubishi_itp_ns.class_(
+    "PassthroughLatencySensor", sensor.Sensor
+)
+PreferenceSavesSensor = mitsubishi_itp_ns.class_(
+    "PreferenceSavesSensor", sensor.Sensor
+)
+ReconnectsSensor = mitsubishi_itp_ns.class_("ReconnectsSensor", sensor.Sensor)
 OutdoorTemperatureSensor = mitsubishi_itp_ns.class_(
     "OutdoorTemperatureSensor", sensor.Sensor
 )
@@ -54,6 +73,24 @@ ThermostatTemperatureSensor = mitsubishi_itp_ns.class_(
     "ThermostatTemperatureSensor", sensor.Sensor
 )
 
+
+def deadband(value):
+    """A deadband is either absolute (e.g. 5), or relative to the last published value (e.g. 10%)."""
+    if isinstance(value, str) and value.endswith("%"):
+        return {"value": cv.positive_float(value[:-1]) / 100, "relative": True}
+    return {"value": cv.positive_float(value), "relative": False}
+
+
+# Options for reducing how often (jittery) values are published, all implemented by MITPSensor
+PUBLISH_FILTER_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_DEADBAND): deadband,
+        cv.Optional(CONF_MIN_PUBLISH_INTERVAL): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_PUBLISH_INTERVAL): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_AVERAGE_WINDOW): cv.int_range(min=2, max=60),
+    }
+)
+
 # TODO Storing the registration function here seems weird, but I can't figure out how to determine schema type later
 SENSORS = dict[str, cv.Schema](
     {
@@ -84,6 +121,28 @@ SENSORS = dict[str, cv.Schema](
             accuracy_decimals=1,
             icon="mdi:sun-thermometer-outline",
         ),
+        CONF_PASSTHROUGH_LATENCY: sensor.sensor_schema(
+            PassthroughLatencySensor,
+            unit_of_measurement=UNIT_MILLISECOND,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            accuracy_decimals=1,
+            icon=ICON_TIMER,
+        ),
+        CONF_PREFERENCE_SAVES: sensor.sensor_schema(
+            PreferenceSavesSensor,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            accuracy_decimals=0,
+            icon="mdi:content-save",
+        ),
+        CONF_RECONNECTS: sensor.sensor_schema(
+            ReconnectsSensor,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            accuracy_decimals=0,
+            icon="mdi:connection",
+        ),
         CONF_RUNTIME: sensor.sensor_schema(
             RuntimeSensor,
             unit_of_measurement=UNIT_MINUTE,
@@ -109,9 +168,38 @@ SENSORS = dict[str, cv.Schema](
     }
 )
 
-CONFIG_SCHEMA = sensors_to_config_schema(SENSORS)
+CONFIG_SCHEMA = sensors_to_config_schema(
+    {
+        sensor_designator: sensor_schema.extend(PUBLISH_FILTER_SCHEMA)
+        for sensor_designator, sensor_schema in SENSORS.items()
+    }
+)
 
 
 @coroutine
 async def to_code(config):
     await sensors_to_code(config, SENSORS, sensor.register_sensor)
+
+    for sensor_designator in SENSORS:
+        if sensor_conf := config.get(sensor_designator):
+            sensor_component = await cg.get_variable(sensor_conf[CONF_ID])
+            if deadband_conf := sensor_conf.get(CONF_DEADBAND):
+                cg.add(
+                    sensor_component.set_deadband(
+                        deadband_conf["value"], deadband_conf["relative"]
+                    )
+                )
+            if min_interval := sensor_conf.get(CONF_MIN_PUBLISH_INTERVAL):
+                cg.add(
+                    sensor_component.set_min_publish_interval(
+                        min_interval.total_milliseconds
+                    )
+                )
+            if max_interval := sensor_conf.get(CONF_MAX_PUBLISH_INTERVAL):
+                cg.add(
+                    sensor_component.set_max_publish_interval(
+                        max_interval.total_milliseconds
+                    )
+                )
+            if average_window := sensor_conf.get(CONF_AVERAGE_WINDOW):
+                cg.add(sensor_component.set_average_window(average_window))
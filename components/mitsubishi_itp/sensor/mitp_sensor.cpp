@@ -0,0 +1,57 @@
+#include "mitp_sensor.h"
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace mitsubishi_itp {
+
+void MITPSensor::publish() {
+  // Only publish if we have a real value
+  if (std::isnan(mitp_sensor_state_)) {
+    return;
+  }
+
+  const float value = window_.empty() ? mitp_sensor_state_ : add_sample_(mitp_sensor_state_);
+  const uint32_t now = millis();
+  if (force_next_publish_ || should_publish_(value, now)) {
+    force_next_publish_ = false;
+    published_value_ = value;
+    published_ms_ = now;
+    publish_state(value);
+  }
+}
+
+bool MITPSensor::should_publish_(const float value, const uint32_t now) const {
+  if (std::isnan(published_value_)) {
+    return true;
+  }
+
+  const uint32_t elapsed = now - published_ms_;
+  if (max_publish_interval_ms_ > 0 && elapsed >= max_publish_interval_ms_) {
+    return true;
+  }
+  // A change held back here is published with a later value (sampled sensors see every value)
+  if (elapsed < min_publish_interval_ms_) {
+    return false;
+  }
+
+  const float threshold = deadband_relative_ ? std::fabs(published_value_) * deadband_ : deadband_;
+  return std::fabs(value - published_value_) > threshold;
+}
+
+// Adds a value to the window, and returns the average of the window
+float MITPSensor::add_sample_(const float value) {
+  window_[window_index_] = value;
+  window_index_ = (window_index_ + 1) % window_.size();
+  if (window_count_ < window_.size()) {
+    window_count_++;
+  }
+
+  float sum = 0;
+  for (uint8_t i = 0; i < window_count_; i++) {
+    sum += window_[i];
+  }
+  return sum / window_count_;
+}
+
+}  // namespace mitsubishi_itp
+}  // namespace esphome
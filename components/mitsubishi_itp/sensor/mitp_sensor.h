@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "esphome/components/sensor/sensor.h"
 #include "../mitp_listener.h"
 
@@ -8,63 +9,133 @@ using namespace itp_packet;
 namespace esphome {
 namespace mitsubishi_itp {
 
+/* Publishes its value when it changes.  Optionally (see sensor/__init__.py), changes smaller than a deadband aren't
+published, publishes are at least a minimum interval apart (and no more than a maximum, even if nothing changed), and
+the value published is the average of the last few values received.*/
 class MITPSensor : public MITPListener, public sensor::Sensor {
  public:
-  void publish() override {
-    // Only publish if force, or a change has occurred and we have a real value
-    if (!std::isnan(mitp_sensor_state_) && mitp_sensor_state_ != state) {
-      publish_state(mitp_sensor_state_);
-    }
+  void set_deadband(const float deadband, const bool relative) {
+    deadband_ = deadband;
+    deadband_relative_ = relative;
+    filtered_ = true;
+  }
+  void set_min_publish_interval(const uint32_t interval_ms) {
+    min_publish_interval_ms_ = interval_ms;
+    filtered_ = true;
+  }
+  void set_max_publish_interval(const uint32_t interval_ms) {
+    max_publish_interval_ms_ = interval_ms;
+    filtered_ = true;
   }
+  void set_average_window(const uint8_t samples) {
+    window_.assign(samples, NAN);
+    filtered_ = true;
+  }
+
+  // When filtering, every value received is needed (to average, or to publish a held-back change), not just changes
+  uint32_t get_sampled_fields() const override { return filtered_ ? get_state_fields() : STATE_FIELDS_NONE; }
+  void publish() override;
 
  protected:
+  bool should_publish_(float value, uint32_t now) const;
+  float add_sample_(float value);
+
   float mitp_sensor_state_ = NAN;
+  bool force_next_publish_ = false;  // If true, will force a publish on next listener->publish() call
+
+ private:
+  bool filtered_ = false;
+  float deadband_ = 0;
+  bool deadband_relative_ = false;  // If true, deadband_ is a fraction of the last published value
+  uint32_t min_publish_interval_ms_ = 0;
+  uint32_t max_publish_interval_ms_ = 0;  // 0 = no maximum
+
+  std::vector<float> window_;  // Last values received, if averaging
+  uint8_t window_index_ = 0;
+  uint8_t window_count_ = 0;
+
+  float published_value_ = NAN;
+  uint32_t published_ms_ = 0;
 };
 
 class CompressorFrequencySensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_COMPRESSOR_FREQUENCY; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_STATUS_GET_RESPONSE); }
   void process_packet(const StatusGetResponsePacket &packet) { mitp_sensor_state_ = packet.get_compressor_frequency(); }
 };
 
 class InputWattsSensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_INPUT_WATTS; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_STATUS_GET_RESPONSE); }
   void process_packet(const StatusGetResponsePacket &packet) { mitp_sensor_state_ = packet.get_input_watts(); }
 };
 
 class LifetimeKwhSensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_LIFETIME_KWH; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_STATUS_GET_RESPONSE); }
   void process_packet(const StatusGetResponsePacket &packet) { mitp_sensor_state_ = packet.get_lifetime_kwh(); }
 };
 
 class OutdoorTemperatureSensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_OUTDOOR_TEMPERATURE; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_CURRENT_TEMP_GET_RESPONSE); }
   void process_packet(const CurrentTempGetResponsePacket &packet) { mitp_sensor_state_ = packet.get_outdoor_temp(); }
 };
 
 class RuntimeSensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_RUNTIME; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_CURRENT_TEMP_GET_RESPONSE); }
   void process_packet(const CurrentTempGetResponsePacket &packet) { mitp_sensor_state_ = packet.get_runtime_minutes(); }
 };
 
+class PassthroughLatencySensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_PASSTHROUGH_LATENCY; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_PASSTHROUGH_LATENCY); }
+  void passthrough_latency(const float latency_ms) override { mitp_sensor_state_ = latency_ms; }
+};
+
+class PreferenceSavesSensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_PREFERENCE_SAVES; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_PREFERENCE_SAVES); }
+  void preference_saves(const uint32_t saves) override { mitp_sensor_state_ = saves; }
+};
+
+class ReconnectsSensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_RECONNECTS; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_LINK_STATE); }
+  void link_state(const bool connected, const uint32_t reconnects) override { mitp_sensor_state_ = reconnects; }
+};
+
 class ThermostatHumiditySensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_THERMOSTAT_HUMIDITY; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_THERMOSTAT_SENSOR_STATUS); }
   void process_packet(const ThermostatSensorStatusPacket &packet) {
     mitp_sensor_state_ = packet.get_indoor_humidity_percent();
   }
 };
 
 class ThermostatTemperatureSensor : public MITPSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_THERMOSTAT_TEMPERATURE; }
+  uint32_t get_subscriptions() const override {
+    return listener_event_bit(LISTENER_EVENT_REMOTE_TEMPERATURE_SET_REQUEST);
+  }
   void process_packet(const RemoteTemperatureSetRequestPacket &packet) {
     if (!packet.get_use_internal_temperature()) {
       mitp_sensor_state_ = packet.get_remote_temperature();
-      force_next_publish_ = true;  // Set true to force publish even if value the same
-    }
-  }
-  void publish() override {
-    // Always publish if force_next_publish_ so that we can expose how often
-    // the thermostat is actually reporting values
-    if (!std::isnan(mitp_sensor_state_) && (mitp_sensor_state_ != state || force_next_publish_)) {
-      force_next_publish_ = false;
-      publish_state(mitp_sensor_state_);
+      // Always publish so that we can expose how often the thermostat is actually reporting values
+      force_next_publish_ = true;
     }
   }
-
- private:
-  bool force_next_publish_ = false;  // If true, will force a publish on next listener->publish() call
 };
 
 }  // namespace mitsubishi_itp
@@ -13,6 +13,9 @@ CONF_THERMOSTAT_BATTERY = "thermostat_battery"
 CONF_ERROR_CODE = "error_code"
 
 ActualFanSensor = mitsubishi_itp_ns.class_("ActualFanSensor", text_sensor.TextSensor)
+CommandResultSensor = mitsubishi_itp_ns.class_(
+    "CommandResultSensor", text_sensor.TextSensor
+)
 ErrorCodeSensor = mitsubishi_itp_ns.class_("ErrorCodeSensor", text_sensor.TextSensor)
 ThermostatBatterySensor = mitsubishi_itp_ns.class_(
     "ThermostatBatterySensor", text_sensor.TextSensor
@@ -25,6 +28,11 @@ SENSORS = dict[str, cv.Schema](
             ActualFanSensor,
             icon="mdi:fan",
         ),
+        # Whether the last settings change was applied as sent, once read back from the heat pump
+        "command_result": text_sensor.text_sensor_schema(
+            CommandResultSensor,
+            icon="mdi:check-circle-outline",
+        ),
         CONF_ERROR_CODE: text_sensor.text_sensor_schema(
             ErrorCodeSensor, icon="mdi:alert-circle-outline"
         ),
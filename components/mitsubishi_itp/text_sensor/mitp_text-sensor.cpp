@@ -6,22 +6,39 @@ namespace mitsubishi_itp {
 void ErrorCodeSensor::process_packet(const ErrorStateGetResponsePacket &packet) {
   // TODO: Include friendly text from JSON, somehow.
   if (!packet.error_present()) {
-    mitp_text_sensor_state_ = std::string("No Error Reported");
-  } else if (auto raw_code = packet.get_raw_short_code() != 0x00) {
+    mitp_text_sensor_key_ = KEY_NO_ERROR;
+  } else if (auto raw_code = packet.get_raw_short_code(); raw_code != 0x00) {
+    const uint32_t key = KEY_SHORT_CODE | raw_code;
+    if (mitp_text_sensor_key_ == key) {
+      return;
+    }
+
     // Not that it matters, but good for validation I guess.
     if ((raw_code & 0x1F) > 0x15) {
       ESP_LOGW(LISTENER_TAG, "Error short code %x had invalid low bits. This is an IT protocol violation!", raw_code);
     }
 
-    mitp_text_sensor_state_ = "Error " + packet.get_short_code();
+    short_code_ = packet.get_short_code();
+    mitp_text_sensor_key_ = key;
+  } else {
+    mitp_text_sensor_key_ = KEY_ERROR_CODE | packet.get_error_code();
+  }
+}
+
+std::string ErrorCodeSensor::state_text_() const {
+  const uint32_t key = mitp_text_sensor_key_.value();
+  if (key == KEY_NO_ERROR) {
+    return "No Error Reported";
+  } else if (key & KEY_SHORT_CODE) {
+    return "Error " + short_code_;
   } else {
-    mitp_text_sensor_state_ = "Error " + to_string(packet.get_error_code());
+    return "Error " + to_string(key & 0xFFFF);
   }
 }
 
 void ThermostatBatterySensor::process_packet(const ThermostatSensorStatusPacket &packet) {
   if (packet.get_flags() & 0x08) {
-    mitp_text_sensor_state_ = THERMOSTAT_BATTERY_STATE_NAMES[packet.get_thermostat_battery_state()];
+    mitp_text_sensor_key_ = packet.get_thermostat_battery_state();
   }
 }
 
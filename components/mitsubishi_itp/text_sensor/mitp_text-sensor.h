@@ -12,28 +12,69 @@ namespace mitsubishi_itp {
 class MITPTextSensor : public MITPListener, public text_sensor::TextSensor {
  public:
   void publish() override {
-    // Only publish if force, or a change has occurred and we have a real value
-    if (mitp_text_sensor_state_.has_value() && mitp_text_sensor_state_.value() != state) {
-      publish_state(mitp_text_sensor_state_.value());
+    // Only publish if a change has occurred and we have a real value
+    if (mitp_text_sensor_key_.has_value() && mitp_text_sensor_key_ != published_key_) {
+      published_key_ = mitp_text_sensor_key_;
+      publish_state(state_text_());
     }
   }
 
  protected:
-  optional<std::string> mitp_text_sensor_state_;
+  // Text for the current key.  Only called when the key has changed, so this is the only place a string is built.
+  virtual std::string state_text_() const = 0;
+  // Identifies the current state (e.g. an index into a table of names), so changes are detected without strings
+  optional<uint32_t> mitp_text_sensor_key_;
+
+ private:
+  optional<uint32_t> published_key_;
 };
 
 class ActualFanSensor : public MITPTextSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_ACTUAL_FAN; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_RUN_STATE_GET_RESPONSE); }
   void process_packet(const RunStateGetResponsePacket &packet) override {
-    mitp_text_sensor_state_ = ACTUAL_FAN_SPEED_NAMES[packet.get_actual_fan_speed()];
+    mitp_text_sensor_key_ = packet.get_actual_fan_speed();
   }
+
+ protected:
+  std::string state_text_() const override { return ACTUAL_FAN_SPEED_NAMES[mitp_text_sensor_key_.value()]; }
+};
+
+class CommandResultSensor : public MITPTextSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_COMMAND_RESULT; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_COMMAND_RESULT); }
+  void command_result(const CommandResult result) override { mitp_text_sensor_key_ = static_cast<uint32_t>(result); }
+
+ protected:
+  std::string state_text_() const override { return COMMAND_RESULT_NAMES[mitp_text_sensor_key_.value()]; }
 };
 
 class ErrorCodeSensor : public MITPTextSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_ERROR; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_ERROR_STATE_GET_RESPONSE); }
   void process_packet(const ErrorStateGetResponsePacket &packet) override;
+
+ protected:
+  // Keys are the kind of error in the upper bits, and its code in the lower
+  static const uint32_t KEY_NO_ERROR = 0;
+  static const uint32_t KEY_SHORT_CODE = 1 << 16;
+  static const uint32_t KEY_ERROR_CODE = 2 << 16;
+
+  std::string state_text_() const override;
+  std::string short_code_;  // Only set when the short code changes
 };
 
 class ThermostatBatterySensor : public MITPTextSensor {
+ public:
+  uint32_t get_state_fields() const override { return STATE_THERMOSTAT_BATTERY; }
+  uint32_t get_subscriptions() const override { return listener_event_bit(LISTENER_EVENT_THERMOSTAT_SENSOR_STATUS); }
   void process_packet(const ThermostatSensorStatusPacket &packet) override;
+
+ protected:
+  std::string state_text_() const override { return THERMOSTAT_BATTERY_STATE_NAMES[mitp_text_sensor_key_.value()]; }
 };
 
 }  // namespace mitsubishi_itp